@@ -7,12 +7,18 @@
 #include <vector>   // std::vector
 
 #include "bitmasks.hpp"
+#include "diagnostic.cpp"
 #include "error.hpp"
 #include "globals.hpp"
+#include "machine.cpp"
 #include "slice.cpp"
+#include "symbols.cpp"
 #include "token.cpp"
 #include "types.hpp"
 
+namespace lasim {
+namespace internal {
+
 using std::vector;
 
 // TODO(feat): Support `.ALIAS`
@@ -20,6 +26,22 @@ using std::vector;
 // This can be large as it is never aggregated
 #define MAX_LINE 512  // Includes '\0'
 
+#define READ_CHUNK_SIZE 4096
+
+// Result of assembling a source buffer
+typedef struct Assembly {
+    // First word is origin, following words are placed in memory from origin
+    vector<Word> words;
+    // Label indexes refer to `words`, so address is `origin + index - 1`
+    vector<LabelDefinition> labels;
+    // Source line of each word in `words`
+    vector<int> line_numbers;
+    // Whether each word in `words` is an instruction, rather than data
+    vector<bool> is_instruction;
+    // Non-empty if assembly failed
+    vector<Diagnostic> diagnostics;
+} Assembly;
+
 // TODO(chore): Document functions
 // TODO(chore): Move all function doc comments to prototypes ?
 // TODO(refactor): Change some out-params to be return values
@@ -31,17 +53,41 @@ void assemble(
 void write_obj_file(
     const char *const filename, const vector<Word> &words, Error &error
 );
-void assemble_file_to_words(
-    const char *const filename, vector<Word> &words, Error &error
+// `source` is kept for symbols
+void assemble_file(
+    const char *const filename,
+    Assembly &assembly,
+    vector<char> &source,
+    Error &error
+);
+// Used by `assemble_file`
+void read_file_to_buffer(
+    const char *const filename, vector<char> &buffer, Error &error
 );
 
-// Used by `assemble_file_to_words`
+// Does not read any file or print anything
+// `length` does not need to include a NUL byte
+void assemble_buffer(
+    const char *const source,
+    const size_t length,
+    Assembly &assembly,
+    Error &error
+);
+
+// Used by `assemble_buffer`
+size_t take_buffer_line(
+    char *const line_buf,
+    const char *const source,
+    const size_t length,
+    size_t &offset
+);
 void parse_line(
     vector<Word> &words,
     const char *&line,
     vector<LabelDefinition> &label_definitions,
     vector<LabelReference> &label_references,
     int line_number,
+    bool &is_instruction,
     bool &is_end,
     bool &failed
 );
@@ -105,23 +151,28 @@ bool does_integer_fit_size_inner(
 void assemble(
     const char *const asm_filename, const ObjectFile &output, Error &error
 ) {
-    vector<Word> words;
-    assemble_file_to_words(asm_filename, words, error);
+    Assembly assembly;
+    vector<char> source;
+    assemble_file(asm_filename, assembly, source, error);
     OK_OR_RETURN(error);
 
+    const vector<Word> &words = assembly.words;
     if (output.kind == ObjectFile::FILE) {
         write_obj_file(output.filename, words, error);
         OK_OR_RETURN(error);
     } else {
-        // TODO(refactor): Write to memory in `assemble_file_to_words`
-        //      Saves a redundant copy of the array
-        const Word origin = words[0];
-        for (size_t i = 1; i < words.size(); ++i) {
-            memory[origin + i - 1] = words[i];
-        }
-        memory_file_bounds.start = origin;
-        memory_file_bounds.end = origin + words.size() - 1;
+        load_words_to_memory(words.data(), words.size(), error);
+        OK_OR_RETURN(error);
     }
+    // Also for symbols file
+    load_symbols(
+        asm_filename,
+        words[0],
+        assembly.labels,
+        assembly.line_numbers,
+        assembly.is_instruction,
+        source
+    );
 }
 
 void write_obj_file(
@@ -134,8 +185,8 @@ void write_obj_file(
     } else {
         obj_file = fopen(filename, "wb");
         if (obj_file == nullptr) {
-            fprintf(
-                stderr, "Failed to open output file for writing: %s\n", filename
+            diagnostic(
+                "Failed to open output file for writing: %s\n", filename
             );
             SET_ERROR(error, FILE);
             return;
@@ -154,14 +205,22 @@ void write_obj_file(
     fclose(obj_file);
 }
 
-void assemble_file_to_words(
-    const char *const filename, vector<Word> &words, Error &error
+void assemble_file(
+    const char *const filename,
+    Assembly &assembly,
+    vector<char> &source,
+    Error &error
 ) {
-    // File errors are fatal to assembly process, all other errors can be
-    // 'ignored' to allow parsing to continue to following lines. However, if
-    // any error occurs, the program will stop after parsing, and not write the
-    // output file (or execute, in ax mode).
+    read_file_to_buffer(filename, source, error);
+    OK_OR_RETURN(error);
+
+    assemble_buffer(source.data(), source.size(), assembly, error);
+    print_diagnostics(assembly.diagnostics);
+}
 
+void read_file_to_buffer(
+    const char *const filename, vector<char> &buffer, Error &error
+) {
     FILE *asm_file;
     if (filename[0] == '\0') {
         asm_file = stdin;
@@ -178,41 +237,74 @@ void assemble_file_to_words(
         }
     }
 
-    vector<LabelDefinition> label_definitions;
+    char chunk[READ_CHUNK_SIZE];
+    while (true) {
+        const size_t bytes_read = fread(chunk, 1, READ_CHUNK_SIZE, asm_file);
+        buffer.insert(buffer.end(), chunk, chunk + bytes_read);
+        if (bytes_read < READ_CHUNK_SIZE)
+            break;
+    }
+    if (ferror(asm_file)) {
+        fprintf(stderr, "Could not read file %s\n", filename);
+        SET_ERROR(error, FILE);
+    }
+
+    fclose(asm_file);
+}
+
+void assemble_buffer(
+    const char *const source,
+    const size_t length,
+    Assembly &assembly,
+    Error &error
+) {
+    // All errors can be 'ignored' to allow parsing to continue to following
+    // lines. However, if any error occurs, the program will stop after
+    // parsing, and not write the output file (or execute, in ax mode).
+
+    vector<Word> &words = assembly.words;
+    vector<LabelDefinition> &label_definitions = assembly.labels;
     vector<LabelReference> label_references;
 
+    // Collect messages instead of printing them
+    vector<Diagnostic> *const previous_list = diagnostics.list;
+    diagnostics.list = &assembly.diagnostics;
+    diagnostics.length = 0;
+
     bool is_end = false;  // Set to `true` by `.END`
 
+    size_t offset = 0;
     char line_buf[MAX_LINE];  // Buffer gets overwritten
     for (int line_number = 1; !is_end; ++line_number) {
         const char *line = line_buf;  // Pointer address is mutated
 
-        if (fgets(line_buf, MAX_LINE, asm_file) == NULL)
+        if (take_buffer_line(line_buf, source, length, offset) == 0)
             break;
-        if (ferror(asm_file)) {
-            SET_ERROR(error, FILE);
-            return;
-        }
 
         bool failed = false;
+        bool is_instruction = false;
         parse_line(
             words,
             line,
             label_definitions,
             label_references,
             line_number,
+            is_instruction,
             is_end,
             failed
         );
+        assembly.line_numbers.resize(words.size(), line_number);
+        assembly.is_instruction.resize(words.size(), is_instruction);
 
-        if (failed) {
-            fprintf(stderr, "\tLine %d\n", line_number);
+        if (failed || diagnostics.length > 0) {
+            push_diagnostic(line_number);
             SET_ERROR(error, ASSEMBLE);
         }
     }
 
     if (!is_end) {
-        fprintf(stderr, "File does not contain `.END` directive\n");
+        diagnostic("File does not contain `.END` directive\n");
+        push_diagnostic(0);
         SET_ERROR(error, ASSEMBLE);
     }
 
@@ -222,8 +314,8 @@ void assemble_file_to_words(
 
         SignedWord index;
         if (!find_label_definition(ref.name, label_definitions, index)) {
-            fprintf(stderr, "Undefined label '%s'\n", ref.name);
-            fprintf(stderr, "\tLine %d\n", ref.line_number);
+            diagnostic("Undefined label '%s'\n", ref.name);
+            push_diagnostic(ref.line_number);
             SET_ERROR(error, ASSEMBLE);
             continue;
         }
@@ -234,12 +326,10 @@ void assemble_file_to_words(
         const SignedWord pc_offset =
             index - static_cast<SignedWord>(ref.index) - 1;
         if (!does_integer_fit_size_inner(pc_offset, size)) {
-            fprintf(
-                stderr,
-                "Label '%s' is too far away to be referenced\n",
-                ref.name
+            diagnostic(
+                "Label '%s' is too far away to be referenced\n", ref.name
             );
-            fprintf(stderr, "\tLine %d\n", ref.line_number);
+            push_diagnostic(ref.line_number);
             SET_ERROR(error, ASSEMBLE);
             continue;
         }
@@ -247,7 +337,28 @@ void assemble_file_to_words(
         words[ref.index] |= pc_offset & mask;
     }
 
-    fclose(asm_file);
+    diagnostics.list = previous_list;
+}
+
+// Copy next line (including '\n') into `line_buf`, like `fgets`
+// Returns amount of characters copied, 0 if buffer is exhausted
+size_t take_buffer_line(
+    char *const line_buf,
+    const char *const source,
+    const size_t length,
+    size_t &offset
+) {
+    size_t i = 0;
+    while (i < MAX_LINE - 1 && offset < length) {
+        const char ch = source[offset];
+        line_buf[i] = ch;
+        ++i;
+        ++offset;
+        if (ch == '\n')
+            break;
+    }
+    line_buf[i] = '\0';
+    return i;
 }
 
 void parse_line(
@@ -256,6 +367,7 @@ void parse_line(
     vector<LabelDefinition> &label_definitions,
     vector<LabelReference> &label_references,
     int line_number,
+    bool &is_instruction,
     bool &is_end,
     bool &failed
 ) {
@@ -269,7 +381,7 @@ void parse_line(
 
     if (words.size() == 0) {
         if (token.kind != TokenKind::DIRECTIVE) {
-            fprintf(stderr, "First line must be `.ORIG` directive\n");
+            diagnostic("First line must be `.ORIG` directive\n");
             failed = true;
             // Silence this error message for following lines
             // Compilation will not succeed regardless
@@ -281,9 +393,7 @@ void parse_line(
         RETURN_IF_FAILED(failed);
         // Must be unsigned
         if (token.kind != TokenKind::INTEGER || token.value.integer.is_signed) {
-            fprintf(
-                stderr, "Positive integer literal required after `.ORIG`\n"
-            );
+            diagnostic("Positive integer literal required after `.ORIG`\n");
             failed = true;
             return;
         }
@@ -299,16 +409,16 @@ void parse_line(
 
         for (size_t i = 0; i < label_definitions.size(); ++i) {
             if (string_equals_slice(label_definitions[i].name, name)) {
-                fprintf(stderr, "Multiple labels are defined with the name '");
-                print_string_slice(stderr, name);
-                fprintf(stderr, "'\n");
+                diagnostic("Multiple labels are defined with the name '");
+                diagnostic_string_slice(name);
+                diagnostic("'\n");
                 failed = true;
                 return;
             }
             if (label_definitions[i].index == index) {
-                fprintf(stderr, "Label defined on already-labelled line '");
-                print_string_slice(stderr, name);
-                fprintf(stderr, "'\n");
+                diagnostic("Label defined on already-labelled line '");
+                diagnostic_string_slice(name);
+                diagnostic("'\n");
                 failed = true;
                 // Don't return, so that label still gets defined
             }
@@ -343,8 +453,7 @@ void parse_line(
         return;
 
     if (token.kind != TokenKind::INSTRUCTION) {
-        fprintf(
-            stderr,
+        diagnostic(
             "Unexpected %s. Expected instruction or end of line\n",
             token_kind_to_string(token.kind)
         );
@@ -367,6 +476,7 @@ void parse_line(
     expect_line_eol(line, failed);
     RETURN_IF_FAILED(failed);
     words.push_back(word);
+    is_instruction = true;
 }
 
 void parse_directive(
@@ -380,7 +490,7 @@ void parse_directive(
 
     switch (directive) {
         case Directive::ORIG:
-            fprintf(stderr, "Unexpected `.ORIG` directive\n");
+            diagnostic("Unexpected `.ORIG` directive\n");
             failed = true;
             return;
 
@@ -405,8 +515,7 @@ void parse_directive(
             RETURN_IF_FAILED(failed);
             if (token.kind != TokenKind::INTEGER ||
                 token.value.integer.is_signed) {
-                fprintf(
-                    stderr,
+                diagnostic(
                     "Positive integer literal required after `.BLKW` "
                     "directive\n"
                 );
@@ -424,8 +533,7 @@ void parse_directive(
             take_next_token(line, token, failed);
             RETURN_IF_FAILED(failed);
             if (token.kind != TokenKind::STRING) {
-                fprintf(
-                    stderr,
+                diagnostic(
                     "String literal required after `.STRINGZ` directive\n"
                 );
                 failed = true;
@@ -438,7 +546,7 @@ void parse_directive(
                     ++i;
                     // "... \" is treated as unterminated
                     if (i > token.value.string.length) {
-                        fprintf(stderr, "Unterminated string literal\n");
+                        diagnostic("Unterminated string literal\n");
                         failed = true;
                         return;
                     }
@@ -603,7 +711,7 @@ void parse_instruction(
                         true
                     );
                 } else {
-                    fprintf(stderr, "Invalid operand\n");
+                    diagnostic("Invalid operand\n");
                     failed = true;
                     return;
                 }
@@ -661,7 +769,7 @@ void parse_instruction(
                     false
                 );
             } else {
-                fprintf(stderr, "Invalid operand\n");
+                diagnostic("Invalid operand\n");
                 failed = true;
                 return;
             }
@@ -724,7 +832,7 @@ void parse_instruction(
                     false
                 );
             } else {
-                fprintf(stderr, "Invalid operand\n");
+                diagnostic("Invalid operand\n");
                 failed = true;
                 return;
             }
@@ -750,8 +858,7 @@ void parse_instruction(
                     // Don't allow explicit sign
                     if (token.kind != TokenKind::INTEGER ||
                         token.value.integer.is_signed) {
-                        fprintf(
-                            stderr,
+                        diagnostic(
                             "Positive integer literal required after "
                             "`TRAP` instruction\n"
                         );
@@ -787,8 +894,7 @@ void print_invalid_operand(
     const TokenKind token_kind,
     Instruction instruction
 ) {
-    fprintf(
-        stderr,
+    diagnostic(
         "Unexpected %s. Expected %s operand for `%s` instruction\n",
         token_kind_to_string(token_kind),
         expected,
@@ -800,7 +906,7 @@ void expect_next_token(const char *&line, Token &token, bool &failed) {
     take_next_token(line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind == TokenKind::EOL) {
-        fprintf(stderr, "Expected operand\n");
+        diagnostic("Expected operand\n");
         failed = true;
     }
 }
@@ -815,7 +921,7 @@ void expect_next_token_after_comma(
         RETURN_IF_FAILED(failed);
     }
     if (token.kind == TokenKind::EOL) {
-        fprintf(stderr, "Expected operand\n");
+        diagnostic("Expected operand\n");
         failed = true;
     }
 }
@@ -826,7 +932,7 @@ void expect_token_is_kind(
     const Token &token, const enum TokenKind kind, bool &failed
 ) {
     if (token.kind != kind) {
-        fprintf(stderr, "Invalid operand\n");
+        diagnostic("Invalid operand\n");
         failed = true;
     }
 }
@@ -835,7 +941,7 @@ void expect_integer_fits_size(
     InitialSignWord integer, size_t size_bits, bool &failed
 ) {
     if (!does_integer_fit_size(integer, size_bits)) {
-        fprintf(stderr, "Immediate too large\n");
+        diagnostic("Immediate too large\n");
         failed = true;
     }
 }
@@ -845,7 +951,7 @@ void expect_line_eol(const char *line, bool &failed) {
     take_next_token(line, token, failed);
     RETURN_IF_FAILED(failed);
     if (token.kind != TokenKind::EOL) {
-        fprintf(stderr, "Unexpected operand after instruction\n");
+        diagnostic("Unexpected operand after instruction\n");
         failed = true;
     }
 }
@@ -941,7 +1047,7 @@ char escape_character(const char ch, bool &failed) {
         case '0':
             return '\0';
         default:
-            fprintf(stderr, "Invalid escape sequence '\\%c'\n", ch);
+            diagnostic("Invalid escape sequence '\\%c'\n", ch);
             failed = true;
             return 0x7f;
     }
@@ -983,4 +1089,7 @@ bool does_integer_fit_size_inner(
     return does_positive_integer_fit_size(integer, size_bits);
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
@@ -0,0 +1,195 @@
+#ifndef BPRED_CPP
+#define BPRED_CPP
+
+#include <cstdio>   // fprintf
+#include <cstring>  // strcmp
+#include <vector>   // std::vector
+
+#include "bitmasks.hpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "profile.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Entries in table of 2-bit counters, and bits of global history for gshare
+#define BPRED_TABLE_BITS 10
+
+enum class PredictorKind {
+    STATIC,   // Backward taken, forward not taken
+    BIMODAL,  // 2-bit counter per (hashed) branch address
+    GSHARE,   // 2-bit counter per branch address XOR global history
+};
+
+// Every `BR` is counted, other than `NOP` (which is never taken)
+// `BRnzp` is always taken, and predicted so from the instruction alone, so it
+//     does not train the counters or history
+typedef struct BranchPredictor {
+    bool is_enabled = false;
+    PredictorKind kind;
+    // 0-1 predict not taken, 2-3 predict taken
+    uint8_t counters[1 << BPRED_TABLE_BITS];
+    Word history;  // Most recent outcome in lowest bit
+
+    // Indexed by branch address
+    vector<uint64_t> executions;
+    vector<uint64_t> taken;
+    vector<uint64_t> mispredictions;
+} BranchPredictor;
+
+static BranchPredictor branch_predictor;
+
+void enable_branch_predictor(const char *const kind, Error &error);
+void branch_predictor_instruction(const Word pc, const Word instr);
+void print_branch_predictor(FILE *const file);
+
+static bool predict_branch(const Word pc, const Word instr);
+static void update_branch_predictor(const Word pc, const bool is_taken);
+static size_t branch_counter_index(const Word pc);
+static const char *predictor_kind_name(const PredictorKind kind);
+
+void enable_branch_predictor(const char *const kind, Error &error) {
+    if (!strcmp(kind, "static")) {
+        branch_predictor.kind = PredictorKind::STATIC;
+    } else if (!strcmp(kind, "bimodal")) {
+        branch_predictor.kind = PredictorKind::BIMODAL;
+    } else if (!strcmp(kind, "gshare")) {
+        branch_predictor.kind = PredictorKind::GSHARE;
+    } else {
+        fprintf(
+            stderr,
+            "Invalid branch predictor: `%s`\n"
+            "\tExpected `static`, `bimodal`, or `gshare`\n",
+            kind
+        );
+        SET_ERROR(error, CLI);
+        return;
+    }
+
+    branch_predictor.is_enabled = true;
+    // Weakly not taken
+    for (size_t i = 0; i < (1 << BPRED_TABLE_BITS); ++i)
+        branch_predictor.counters[i] = 1;
+    branch_predictor.history = 0;
+    branch_predictor.executions.assign(MEMORY_SIZE, 0);
+    branch_predictor.taken.assign(MEMORY_SIZE, 0);
+    branch_predictor.mispredictions.assign(MEMORY_SIZE, 0);
+}
+
+// Called after `instr` at `pc` executed
+void branch_predictor_instruction(const Word pc, const Word instr) {
+    if (static_cast<Opcode>(bits_12_15(instr)) != Opcode::BR)
+        return;
+    const Word condition_mask = bits_9_11(instr);
+    if (condition_mask == 0b000)
+        return;
+
+    // Branch does not modify condition
+    const Word condition = static_cast<Word>(machine->registers.condition);
+    const bool is_taken = (condition_mask & condition) != 0;
+
+    ++branch_predictor.executions[pc];
+    if (is_taken)
+        ++branch_predictor.taken[pc];
+    if (condition_mask == 0b111)
+        return;
+    if (predict_branch(pc, instr) != is_taken)
+        ++branch_predictor.mispredictions[pc];
+    update_branch_predictor(pc, is_taken);
+}
+
+void print_branch_predictor(FILE *const file) {
+    const BranchPredictor &predictor = branch_predictor;
+    uint64_t executions = 0;
+    uint64_t mispredictions = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        executions += predictor.executions[i];
+        mispredictions += predictor.mispredictions[i];
+    }
+
+    fprintf(
+        file,
+        "\nBranch predictor (%s): %lu branches, %lu mispredicted",
+        predictor_kind_name(predictor.kind),
+        static_cast<unsigned long>(executions),
+        static_cast<unsigned long>(mispredictions)
+    );
+    if (executions > 0) {
+        fprintf(
+            file,
+            " (%.1f%% accuracy)",
+            100.0 * (executions - mispredictions) / executions
+        );
+    }
+    fprintf(file, "\n");
+    if (executions == 0)
+        return;
+
+    // Programs have few branches, so list all
+    fprintf(
+        file, "     EXECUTED   TAKEN  MISPREDICTED  ADDRESS  LINE  LABEL\n"
+    );
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        const uint64_t count = predictor.executions[i];
+        if (count == 0)
+            continue;
+        fprintf(
+            file,
+            "  %11lu  %5.1f%%   %11lu   0x%04zx",
+            static_cast<unsigned long>(count),
+            100.0 * predictor.taken[i] / count,
+            static_cast<unsigned long>(predictor.mispredictions[i]),
+            i
+        );
+        print_address_location(file, static_cast<Word>(i));
+        fprintf(file, "\n");
+    }
+}
+
+static bool predict_branch(const Word pc, const Word instr) {
+    if (branch_predictor.kind == PredictorKind::STATIC) {
+        // Negative offset
+        return (instr >> 8 & 0b1) != 0;
+    }
+    return branch_predictor.counters[branch_counter_index(pc)] >= 2;
+}
+
+static void update_branch_predictor(const Word pc, const bool is_taken) {
+    if (branch_predictor.kind == PredictorKind::STATIC)
+        return;
+    uint8_t &counter = branch_predictor.counters[branch_counter_index(pc)];
+    if (is_taken && counter < 3)
+        ++counter;
+    if (!is_taken && counter > 0)
+        --counter;
+    branch_predictor.history =
+        static_cast<Word>(branch_predictor.history << 1 | is_taken);
+}
+
+static size_t branch_counter_index(const Word pc) {
+    const size_t mask = (1 << BPRED_TABLE_BITS) - 1;
+    if (branch_predictor.kind == PredictorKind::GSHARE)
+        return (pc ^ branch_predictor.history) & mask;
+    return pc & mask;
+}
+
+static const char *predictor_kind_name(const PredictorKind kind) {
+    switch (kind) {
+        case PredictorKind::STATIC:
+            return "static";
+        case PredictorKind::BIMODAL:
+            return "bimodal";
+        case PredictorKind::GSHARE:
+            return "gshare";
+    }
+    UNREACHABLE();
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef CACHE_CPP
+#define CACHE_CPP
+
+#include <cstdint>  // SIZE_MAX
+#include <cstdio>   // fprintf
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "profile.cpp"
+#include "spec.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+#define CACHE_HOTTEST_COUNT 10
+
+// Sizes are in words, as LC-3 memory is word-addressed
+// Size, line size, and set count must be powers of 2
+typedef struct CacheConfig {
+    size_t size;
+    size_t line_size;
+    size_t ways;
+    bool is_fifo;           // Otherwise LRU
+    bool is_write_through;  // Without allocation, otherwise write-back
+} CacheConfig;
+
+typedef struct CacheLine {
+    bool is_valid;
+    bool is_dirty;
+    Word tag;
+    // Time of last use (LRU) or of fill (FIFO)
+    uint64_t stamp;
+} CacheLine;
+
+typedef struct Cache {
+    bool is_enabled = false;
+    const char *name;
+    CacheConfig config;
+
+    size_t set_count;
+    size_t line_shift;
+    size_t set_shift;
+    // `ways` consecutive lines per set
+    vector<CacheLine> lines;
+    uint64_t clock;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t write_backs;    // Dirty lines evicted (write-back)
+    uint64_t memory_writes;  // Writes passed to memory (write-through)
+    // Indexed by PC of instruction making the access
+    vector<uint64_t> pc_hits;
+    vector<uint64_t> pc_misses;
+} Cache;
+
+// Instruction fetches, and data reads/writes
+static Cache instruction_cache;
+static Cache data_cache;
+
+void enable_cache(
+    Cache &cache,
+    const char *const name,
+    const char *const spec,
+    Error &error
+);
+void cache_access(
+    Cache &cache, const Word pc, const Word addr, const bool is_write
+);
+void print_cache(FILE *const file, const Cache &cache);
+
+static bool parse_cache_config(const char *spec, CacheConfig &config);
+static size_t log2_exact(const size_t value);
+
+// `spec` is comma-separated `KEY=VALUE` fields, all optional:
+//     size=WORDS  line=WORDS  ways=N  replace=lru|fifo  write=back|through
+void enable_cache(
+    Cache &cache,
+    const char *const name,
+    const char *const spec,
+    Error &error
+) {
+    CacheConfig &config = cache.config;
+    if (!parse_cache_config(spec, config)) {
+        fprintf(stderr, "Invalid cache configuration: `%s`\n", spec);
+        SET_ERROR(error, CLI);
+        return;
+    }
+
+    const size_t line_count =
+        config.line_size > 0 ? config.size / config.line_size : 0;
+    cache.set_count = config.ways > 0 ? line_count / config.ways : 0;
+    const size_t line_shift = log2_exact(config.line_size);
+    const size_t set_shift = log2_exact(cache.set_count);
+    if (line_shift == SIZE_MAX || set_shift == SIZE_MAX ||
+        cache.set_count * config.ways * config.line_size != config.size ||
+        config.size > MEMORY_SIZE) {
+        fprintf(
+            stderr,
+            "Invalid cache dimensions: `%s`\n"
+            "\tLine size and set count must be powers of 2\n",
+            spec
+        );
+        SET_ERROR(error, CLI);
+        return;
+    }
+
+    cache.is_enabled = true;
+    cache.name = name;
+    cache.line_shift = line_shift;
+    cache.set_shift = set_shift;
+    cache.lines.assign(line_count, {false, false, 0, 0});
+    cache.clock = 0;
+    cache.hits = 0;
+    cache.misses = 0;
+    cache.write_backs = 0;
+    cache.memory_writes = 0;
+    cache.pc_hits.assign(MEMORY_SIZE, 0);
+    cache.pc_misses.assign(MEMORY_SIZE, 0);
+}
+
+void cache_access(
+    Cache &cache, const Word pc, const Word addr, const bool is_write
+) {
+    const CacheConfig &config = cache.config;
+    const size_t block = addr >> cache.line_shift;
+    const size_t set = block & (cache.set_count - 1);
+    const Word tag = static_cast<Word>(block >> cache.set_shift);
+    CacheLine *const lines = cache.lines.data() + set * config.ways;
+
+    ++cache.clock;
+    if (is_write && config.is_write_through)
+        ++cache.memory_writes;
+
+    for (size_t i = 0; i < config.ways; ++i) {
+        CacheLine &line = lines[i];
+        if (line.is_valid && line.tag == tag) {
+            ++cache.hits;
+            ++cache.pc_hits[pc];
+            if (!config.is_fifo)
+                line.stamp = cache.clock;
+            if (is_write && !config.is_write_through)
+                line.is_dirty = true;
+            return;
+        }
+    }
+
+    ++cache.misses;
+    ++cache.pc_misses[pc];
+    // No allocation on write miss
+    if (is_write && config.is_write_through)
+        return;
+
+    // Invalid line, otherwise oldest stamp
+    CacheLine *victim = &lines[0];
+    for (size_t i = 0; i < config.ways; ++i) {
+        if (!lines[i].is_valid) {
+            victim = &lines[i];
+            break;
+        }
+        if (lines[i].stamp < victim->stamp)
+            victim = &lines[i];
+    }
+    if (victim->is_valid && victim->is_dirty)
+        ++cache.write_backs;
+    victim->is_valid = true;
+    victim->is_dirty = is_write;
+    victim->tag = tag;
+    victim->stamp = cache.clock;
+}
+
+void print_cache(FILE *const file, const Cache &cache) {
+    const CacheConfig &config = cache.config;
+    fprintf(
+        file,
+        "\n%s: %zu words, %zu-word lines, %zu-way, %s, %s\n",
+        cache.name,
+        config.size,
+        config.line_size,
+        config.ways,
+        config.is_fifo ? "FIFO" : "LRU",
+        config.is_write_through ? "write-through" : "write-back"
+    );
+
+    const uint64_t accesses = cache.hits + cache.misses;
+    fprintf(
+        file,
+        "    %lu accesses, %lu hits (%.1f%%), %lu misses\n",
+        static_cast<unsigned long>(accesses),
+        static_cast<unsigned long>(cache.hits),
+        accesses > 0 ? 100.0 * cache.hits / accesses : 0.0,
+        static_cast<unsigned long>(cache.misses)
+    );
+    if (cache.memory_writes > 0) {
+        fprintf(
+            file,
+            "    %lu writes to memory\n",
+            static_cast<unsigned long>(cache.memory_writes)
+        );
+    }
+    if (cache.write_backs > 0) {
+        fprintf(
+            file,
+            "    %lu write-backs\n",
+            static_cast<unsigned long>(cache.write_backs)
+        );
+    }
+
+    Word hottest[CACHE_HOTTEST_COUNT];
+    const size_t hottest_count = find_hottest_addresses(
+        cache.pc_misses.data(), hottest, CACHE_HOTTEST_COUNT
+    );
+    if (hottest_count == 0)
+        return;
+    fprintf(file, "    Most misses by instruction:\n");
+    fprintf(file, "         MISSES         HITS       PC  LINE  LABEL\n");
+    for (size_t i = 0; i < hottest_count; ++i) {
+        const Word pc = hottest[i];
+        fprintf(
+            file,
+            "    %11lu  %11lu   0x%04hx",
+            static_cast<unsigned long>(cache.pc_misses[pc]),
+            static_cast<unsigned long>(cache.pc_hits[pc]),
+            pc
+        );
+        print_address_location(file, pc);
+        fprintf(file, "\n");
+    }
+}
+
+static bool parse_cache_config(const char *spec, CacheConfig &config) {
+    config.size = 256;
+    config.line_size = 4;
+    config.ways = 1;
+    config.is_fifo = false;
+    config.is_write_through = false;
+
+    while (*spec != '\0') {
+        const char *value;
+        if (parse_spec_field(spec, "size", value)) {
+            if (!parse_spec_number(value, spec, config.size))
+                return false;
+        } else if (parse_spec_field(spec, "line", value)) {
+            if (!parse_spec_number(value, spec, config.line_size))
+                return false;
+        } else if (parse_spec_field(spec, "ways", value)) {
+            if (!parse_spec_number(value, spec, config.ways))
+                return false;
+        } else if (parse_spec_field(spec, "replace", value)) {
+            if (spec_value_equals(value, spec, "lru"))
+                config.is_fifo = false;
+            else if (spec_value_equals(value, spec, "fifo"))
+                config.is_fifo = true;
+            else
+                return false;
+        } else if (parse_spec_field(spec, "write", value)) {
+            if (spec_value_equals(value, spec, "back"))
+                config.is_write_through = false;
+            else if (spec_value_equals(value, spec, "through"))
+                config.is_write_through = true;
+            else
+                return false;
+        } else {
+            return false;
+        }
+
+        if (*spec == ',')
+            ++spec;
+    }
+    return true;
+}
+
+// `SIZE_MAX` if not a power of 2
+static size_t log2_exact(const size_t value) {
+    for (size_t shift = 0; shift < 32; ++shift) {
+        if (value == static_cast<size_t>(1) << shift)
+            return shift;
+    }
+    return SIZE_MAX;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef CALLGRAPH_CPP
+#define CALLGRAPH_CPP
+
+#include <cstdio>  // fprintf, fopen
+#include <vector>  // std::vector
+
+#include "bitmasks.hpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "symbols.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Deeper calls are counted in the deepest frame, so runaway recursion does
+//     not grow the tree without bound
+// Their returns are matched by `overflow_depth`, so they do not pop frames
+#define CALLGRAPH_MAX_DEPTH 256
+
+#define CALLGRAPH_NO_NODE (static_cast<size_t>(-1))
+
+// A distinct stack of calls, as a node in a tree from the program start
+// Children are a linked list, as most subroutines call only a few others
+typedef struct CallNode {
+    Word entry;  // Address of subroutine
+    size_t parent;
+    size_t first_child;
+    size_t next_sibling;
+    uint64_t self_count;  // Instructions executed with this exact stack
+} CallNode;
+
+// Shadow call stack, following `JSR`/`JSRR` and `RET`
+typedef struct CallFrame {
+    size_t node;
+    Word return_address;
+} CallFrame;
+
+typedef struct CallGraph {
+    bool is_enabled = false;
+    FILE *folded_file;  // Opened when enabled, so errors are reported early
+    vector<CallNode> nodes;
+    vector<CallFrame> stack;  // Current node is at top
+    size_t overflow_depth;    // Calls not pushed, beyond maximum depth
+} CallGraph;
+
+static CallGraph callgraph;
+
+void enable_callgraph(const char *const filename, Error &error);
+void callgraph_instruction(const Word pc, const Word instr);
+void print_callgraph(FILE *const file);
+
+static size_t find_call_node(const size_t parent, const Word entry);
+static void write_folded_stacks(FILE *const file);
+static void write_folded_stack(FILE *const file, const size_t node);
+static void print_entry_name(FILE *const file, const Word entry);
+
+void enable_callgraph(const char *const filename, Error &error) {
+    callgraph.folded_file = fopen(filename, "w");
+    if (callgraph.folded_file == nullptr) {
+        fprintf(
+            stderr,
+            "Failed to open call graph file for writing: %s\n",
+            filename
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+    callgraph.is_enabled = true;
+    callgraph.nodes.clear();
+    callgraph.stack.clear();
+    callgraph.overflow_depth = 0;
+}
+
+// Called after `instr` at `pc` executed
+void callgraph_instruction(const Word pc, const Word instr) {
+    vector<CallFrame> &stack = callgraph.stack;
+    const Word next_pc = machine->registers.program_counter;
+
+    // Root is created lazily, as PC is not set when enabled
+    if (stack.empty()) {
+        callgraph.nodes.push_back(
+            {pc, CALLGRAPH_NO_NODE, CALLGRAPH_NO_NODE, CALLGRAPH_NO_NODE, 0}
+        );
+        stack.push_back({0, 0});
+    }
+
+    ++callgraph.nodes[stack.back().node].self_count;
+
+    const Opcode opcode = static_cast<Opcode>(bits_12_15(instr));
+    if (opcode == Opcode::JSR_JSRR) {
+        if (stack.size() >= CALLGRAPH_MAX_DEPTH) {
+            ++callgraph.overflow_depth;
+            return;
+        }
+        const size_t node = find_call_node(stack.back().node, next_pc);
+        stack.push_back({node, static_cast<Word>(pc + 1)});
+    } else if (opcode == Opcode::JMP_RET && bits_6_8(instr) == 7) {
+        if (callgraph.overflow_depth > 0) {
+            --callgraph.overflow_depth;
+            return;
+        }
+        // Return to the matching frame, if `R7` was not modified
+        // Otherwise, assume only the top frame returned
+        size_t frame = stack.size() - 1;
+        while (frame > 0 && stack[frame].return_address != next_pc)
+            --frame;
+        if (frame == 0)
+            frame = stack.size() - 1;
+        if (frame > 0)
+            stack.resize(frame);
+    }
+}
+
+static size_t find_call_node(const size_t parent, const Word entry) {
+    vector<CallNode> &nodes = callgraph.nodes;
+    size_t child = nodes[parent].first_child;
+    while (child != CALLGRAPH_NO_NODE) {
+        if (nodes[child].entry == entry)
+            return child;
+        child = nodes[child].next_sibling;
+    }
+
+    nodes.push_back(
+        {entry, parent, CALLGRAPH_NO_NODE, nodes[parent].first_child, 0}
+    );
+    const size_t node = nodes.size() - 1;
+    nodes[parent].first_child = node;
+    return node;
+}
+
+// Inclusive and exclusive counts per subroutine, and write folded stacks
+void print_callgraph(FILE *const file) {
+    const vector<CallNode> &nodes = callgraph.nodes;
+
+    // Children are always created after their parent, so iterating backwards
+    //     visits each child before its parent
+    vector<uint64_t> totals(nodes.size(), 0);
+    for (size_t i = nodes.size(); i-- > 0;) {
+        totals[i] += nodes[i].self_count;
+        if (nodes[i].parent != CALLGRAPH_NO_NODE)
+            totals[nodes[i].parent] += totals[i];
+    }
+
+    // Distinct subroutines, in order of first call
+    vector<Word> entries;
+    vector<uint64_t> inclusive;
+    vector<uint64_t> exclusive;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        size_t index = 0;
+        while (index < entries.size() && entries[index] != nodes[i].entry)
+            ++index;
+        if (index == entries.size()) {
+            entries.push_back(nodes[i].entry);
+            inclusive.push_back(0);
+            exclusive.push_back(0);
+        }
+        exclusive[index] += nodes[i].self_count;
+
+        // Recursive calls are already included by the outermost call
+        bool is_recursive = false;
+        for (size_t parent = nodes[i].parent; parent != CALLGRAPH_NO_NODE;
+             parent = nodes[parent].parent) {
+            if (nodes[parent].entry == nodes[i].entry) {
+                is_recursive = true;
+                break;
+            }
+        }
+        if (!is_recursive)
+            inclusive[index] += totals[i];
+    }
+
+    fprintf(file, "\nCall graph:\n");
+    fprintf(file, "  INCLUSIVE    EXCLUSIVE  SUBROUTINE\n");
+    for (size_t i = 0; i < entries.size(); ++i) {
+        fprintf(
+            file,
+            "%11lu  %11lu  ",
+            static_cast<unsigned long>(inclusive[i]),
+            static_cast<unsigned long>(exclusive[i])
+        );
+        print_entry_name(file, entries[i]);
+        fprintf(file, "\n");
+    }
+
+    write_folded_stacks(callgraph.folded_file);
+    fclose(callgraph.folded_file);
+}
+
+// One line per distinct stack: names separated by ';', then the count
+static void write_folded_stacks(FILE *const file) {
+    for (size_t i = 0; i < callgraph.nodes.size(); ++i) {
+        const uint64_t count = callgraph.nodes[i].self_count;
+        if (count == 0)
+            continue;
+        write_folded_stack(file, i);
+        fprintf(file, " %lu\n", static_cast<unsigned long>(count));
+    }
+}
+
+static void write_folded_stack(FILE *const file, const size_t node) {
+    const size_t parent = callgraph.nodes[node].parent;
+    if (parent != CALLGRAPH_NO_NODE) {
+        write_folded_stack(file, parent);
+        fprintf(file, ";");
+    }
+    print_entry_name(file, callgraph.nodes[node].entry);
+}
+
+// Label if subroutine starts at one, otherwise the address
+static void print_entry_name(FILE *const file, const Word entry) {
+    const Symbol *const symbol = find_symbol_before(entry);
+    if (symbol != nullptr && symbol->address == entry)
+        fprintf(file, "%s", symbol->name);
+    else
+        fprintf(file, "x%04hx", entry);
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -6,6 +6,10 @@
 #include <cstring>  // strcpy
 
 #include "error.hpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
 
 #define PROGRAM_NAME "lasim"
 
@@ -21,6 +25,10 @@ enum class Mode {
     ASSEMBLE_EXECUTE,  // (default)
     ASSEMBLE_ONLY,     // -a
     EXECUTE_ONLY,      // -x
+    SERVE,             // --serve
+    TRACE_QUERY,       // --trace-query
+    RESUME,            // --snapshot
+    FUZZ,              // --fuzz
 };
 
 // TODO(feat): Verbose mode
@@ -32,11 +40,68 @@ struct Options {
     char out_filename[FILENAME_MAX];
     bool debugger = false;
     bool debugger_quiet = false;
+    // Instructions which the debugger can reverse, or 0 if not kept (unless
+    //     a debug script reverses)
+    size_t undo_log_size = 0;
+    // Empty if debugger commands are read from stdin
+    char debug_script_filename[FILENAME_MAX] = {0};
+    // Unix domain socket path for `--serve`
+    char socket_filename[FILENAME_MAX];
+    Limits limits = {0, 0, 0};
+    bool detect_loops = false;
+    bool profile = false;
+    // Empty if call graph is not enabled
+    char callgraph_filename[FILENAME_MAX] = {0};
+    char heatmap_filename[FILENAME_MAX] = {0};
+    // `nullptr` if cache is not simulated
+    const char *instruction_cache_spec = nullptr;
+    const char *data_cache_spec = nullptr;
+    // `nullptr` if branches are not predicted
+    const char *branch_predictor = nullptr;
+    // `nullptr` if pipeline is not modelled
+    const char *pipeline_spec = nullptr;
+    // Empty if execution is not traced
+    char trace_filename[FILENAME_MAX] = {0};
+    // `nullptr` if coverage is not reported, empty if bitmap is not merged
+    const char *coverage_filename = nullptr;
+    // Empty if lcov file is not written
+    char lcov_filename[FILENAME_MAX] = {0};
+    // Trace to query with `--trace-query`
+    char trace_query_filename[FILENAME_MAX];
+    // Snapshot to resume with `--snapshot`
+    char snapshot_filename[FILENAME_MAX];
+    // Empty if no snapshot is saved
+    char save_snapshot_filename[FILENAME_MAX] = {0};
+    // Written if execution fails, default set by `try_run` if empty
+    char crash_dump_filename[FILENAME_MAX] = {0};
+    bool crash_dump = true;
+    // Written when assembling, otherwise read, unless empty
+    char symbols_filename[FILENAME_MAX] = {0};
+    // Object to fuzz with `--fuzz`, with corpus directory as input file
+    char fuzz_filename[FILENAME_MAX];
+    // 0 to run until interrupted
+    uint64_t fuzz_runs = 0;
 };
 
 void parse_options(
     Options &options, const int argc, const char *const *const argv
 );
+void parse_long_option(
+    Options &options,
+    const char *const arg,
+    const int argc,
+    const char *const *const argv,
+    int &i
+);
+const char *expect_long_option_value(
+    const char *const name,
+    const char *value,
+    const int argc,
+    const char *const *const argv,
+    int &i
+);
+uint64_t expect_long_option_integer(const char *const name, const char *value);
+void expect_no_long_option_value(const char *const name, const char *value);
 void print_usage_hint(void);
 void print_usage(void);
 void strcpy_max_size(
@@ -87,6 +152,11 @@ void parse_options(
             exit(static_cast<int>(Error::CLI));
         }
 
+        if (arg[0] == '-') {
+            parse_long_option(options, arg + 1, argc, argv, i);
+            continue;
+        }
+
         for (char option; (option = arg[0]) != '\0'; ++arg) {
             switch (option) {
                 // Help
@@ -200,12 +270,144 @@ void parse_options(
         }
     }
 
-    if (!in_file_set) {
+    // Implies `-d`
+    if (options.debug_script_filename[0] != '\0')
+        options.debugger = true;
+
+    const bool has_limits = options.limits.max_instructions > 0 ||
+                            options.limits.max_output > 0 ||
+                            options.limits.max_milliseconds > 0 ||
+                            options.detect_loops;
+    const bool has_analysis = options.profile ||
+                              options.callgraph_filename[0] != '\0' ||
+                              options.heatmap_filename[0] != '\0' ||
+                              options.instruction_cache_spec != nullptr ||
+                              options.data_cache_spec != nullptr ||
+                              options.branch_predictor != nullptr ||
+                              options.pipeline_spec != nullptr ||
+                              options.trace_filename[0] != '\0' ||
+                              options.coverage_filename != nullptr ||
+                              options.lcov_filename[0] != '\0';
+
+    const bool has_save_snapshot = options.save_snapshot_filename[0] != '\0';
+    const bool has_symbols = options.symbols_filename[0] != '\0';
+
+    // Read instead of assembling input for labels
+    if (has_symbols && in_file_set &&
+        (options.mode == Mode::TRACE_QUERY || options.mode == Mode::RESUME)) {
+        fprintf(stderr, "Cannot specify both input file and `--symbols`\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if (options.mode == Mode::SERVE) {
+        if (in_file_set || out_file_set || options.debugger || has_limits ||
+            has_analysis || has_save_snapshot || has_symbols) {
+            fprintf(stderr, "Cannot specify other options with `--serve`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        return;
+    }
+
+    if (options.mode == Mode::FUZZ) {
+        if (out_file_set || options.debugger || has_analysis ||
+            has_save_snapshot || has_symbols) {
+            fprintf(
+                stderr,
+                "Cannot specify options other than limits with `--fuzz`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        if (!in_file_set || options.in_filename[0] == '\0') {
+            fprintf(stderr, "No corpus directory specified\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        return;
+    }
+    if (options.fuzz_runs > 0) {
+        fprintf(stderr, "Cannot specify `--fuzz-runs` without `--fuzz`\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
+    if (options.mode == Mode::TRACE_QUERY) {
+        if (out_file_set || options.debugger || has_limits || has_analysis ||
+            has_save_snapshot) {
+            fprintf(
+                stderr,
+                "Cannot specify options other than input file with "
+                "`--trace-query`\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        // Input file is optional, and only used for labels
+        if (!in_file_set) {
+            options.in_filename[0] = '\0';
+        } else if (options.in_filename[0] == '\0') {
+            fprintf(
+                stderr,
+                "Cannot read input from stdin with `--trace-query`, as "
+                "queries are read from stdin\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        return;
+    }
+
+    if (has_save_snapshot) {
+        if (options.mode == Mode::ASSEMBLE_ONLY) {
+            fprintf(stderr, "Cannot save snapshot in assemble-only mode\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        // `DEBUG` trap is a breakpoint in the debugger
+        if (options.debugger) {
+            fprintf(stderr, "Cannot specify `--save-snapshot` with `-d`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+    }
+
+    if (options.mode == Mode::RESUME) {
+        if (out_file_set) {
+            fprintf(stderr, "Cannot specify output file with `--snapshot`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        // Input file is optional, and only used for labels
+        if (!in_file_set) {
+            options.in_filename[0] = '\0';
+        } else if (options.in_filename[0] == '\0') {
+            fprintf(
+                stderr,
+                "Cannot read input from stdin with `--snapshot`, as stdin "
+                "is program input\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+    } else if (!in_file_set) {
         fprintf(stderr, "No input file specified\n");
         print_usage_hint();
         exit(static_cast<int>(Error::CLI));
     }
 
+    if (has_limits && options.mode == Mode::ASSEMBLE_ONLY) {
+        fprintf(stderr, "Cannot specify limits in assemble-only mode\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+    if (has_analysis && options.mode == Mode::ASSEMBLE_ONLY) {
+        fprintf(stderr, "Cannot profile in assemble-only mode\n");
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+
     if (options.debugger) {
         if (options.mode == Mode::ASSEMBLE_ONLY) {
             fprintf(stderr, "Cannot use debugger in assemble-only mode\n");
@@ -218,9 +420,16 @@ void parse_options(
             print_usage_hint();
             exit(static_cast<int>(Error::CLI));
         }
+        if (options.undo_log_size > 0) {
+            fprintf(stderr, "Cannot specify `--reverse-log` without `-d`\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
     }
 
-    if (options.mode == Mode::EXECUTE_ONLY) {
+    if (options.mode == Mode::RESUME) {
+        return;
+    } else if (options.mode == Mode::EXECUTE_ONLY) {
         if (out_file_set) {
             fprintf(stderr, "Cannot specify output file with `-x`\n");
             print_usage_hint();
@@ -245,6 +454,247 @@ void parse_options(
     }
 }
 
+// `arg` does not include leading `--`
+// Takes `--NAME VALUE` or `--NAME=VALUE` for options with a value
+void parse_long_option(
+    Options &options,
+    const char *const arg,
+    const int argc,
+    const char *const *const argv,
+    int &i
+) {
+    char name[FILENAME_MAX];
+    const char *value = strchr(arg, '=');
+    if (value == nullptr) {
+        strcpy_max_size(name, arg, FILENAME_MAX - 1);
+    } else {
+        const size_t length = value - arg;
+        strcpy_max_size(
+            name, arg, length < FILENAME_MAX - 1 ? length : FILENAME_MAX - 1
+        );
+        ++value;  // Move past `=`
+    }
+
+    if (!strcmp(name, "serve")) {
+        if (options.mode != Mode::ASSEMBLE_EXECUTE) {
+            fprintf(stderr, "Cannot specify `--serve` with another mode\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.mode = Mode::SERVE;
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.socket_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+
+    if (!strcmp(name, "max-instructions")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        options.limits.max_instructions =
+            expect_long_option_integer(name, value);
+        return;
+    }
+    if (!strcmp(name, "max-output")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        options.limits.max_output = expect_long_option_integer(name, value);
+        return;
+    }
+    if (!strcmp(name, "max-time")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        options.limits.max_milliseconds =
+            expect_long_option_integer(name, value);
+        return;
+    }
+    if (!strcmp(name, "detect-loops")) {
+        expect_no_long_option_value(name, value);
+        options.detect_loops = true;
+        return;
+    }
+
+    if (!strcmp(name, "debug-script")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(
+            options.debug_script_filename, value, FILENAME_MAX - 1
+        );
+        return;
+    }
+    if (!strcmp(name, "reverse-log")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        options.undo_log_size = expect_long_option_integer(name, value);
+        return;
+    }
+
+    if (!strcmp(name, "profile")) {
+        expect_no_long_option_value(name, value);
+        options.profile = true;
+        return;
+    }
+    if (!strcmp(name, "callgraph")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.callgraph_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "heatmap")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.heatmap_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "icache")) {
+        options.instruction_cache_spec =
+            expect_long_option_value(name, value, argc, argv, i);
+        return;
+    }
+    if (!strcmp(name, "dcache")) {
+        options.data_cache_spec =
+            expect_long_option_value(name, value, argc, argv, i);
+        return;
+    }
+    if (!strcmp(name, "bpred")) {
+        options.branch_predictor =
+            expect_long_option_value(name, value, argc, argv, i);
+        return;
+    }
+    if (!strcmp(name, "pipeline")) {
+        // Value is optional, so must be given with `=`
+        options.pipeline_spec = value == nullptr ? "" : value;
+        return;
+    }
+    if (!strcmp(name, "coverage")) {
+        // Value is optional, so must be given with `=`
+        options.coverage_filename = value == nullptr ? "" : value;
+        return;
+    }
+    if (!strcmp(name, "lcov")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.lcov_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "trace-query")) {
+        if (options.mode != Mode::ASSEMBLE_EXECUTE) {
+            fprintf(
+                stderr, "Cannot specify `--trace-query` with another mode\n"
+            );
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.mode = Mode::TRACE_QUERY;
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.trace_query_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "snapshot")) {
+        if (options.mode != Mode::ASSEMBLE_EXECUTE) {
+            fprintf(stderr, "Cannot specify `--snapshot` with another mode\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.mode = Mode::RESUME;
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.snapshot_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "fuzz")) {
+        if (options.mode != Mode::ASSEMBLE_EXECUTE) {
+            fprintf(stderr, "Cannot specify `--fuzz` with another mode\n");
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        options.mode = Mode::FUZZ;
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.fuzz_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "fuzz-runs")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        options.fuzz_runs = expect_long_option_integer(name, value);
+        return;
+    }
+    if (!strcmp(name, "save-snapshot")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(
+            options.save_snapshot_filename, value, FILENAME_MAX - 1
+        );
+        return;
+    }
+    if (!strcmp(name, "crash-dump")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.crash_dump_filename, value, FILENAME_MAX - 1);
+        options.crash_dump = true;
+        return;
+    }
+    if (!strcmp(name, "no-crash-dump")) {
+        expect_no_long_option_value(name, value);
+        options.crash_dump = false;
+        return;
+    }
+    if (!strcmp(name, "symbols")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.symbols_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+    if (!strcmp(name, "trace")) {
+        value = expect_long_option_value(name, value, argc, argv, i);
+        strcpy_max_size(options.trace_filename, value, FILENAME_MAX - 1);
+        return;
+    }
+
+    fprintf(stderr, "Invalid option: `--%s`\n", name);
+    print_usage_hint();
+    exit(static_cast<int>(Error::CLI));
+}
+
+// Use value after `=`, or take next argument
+const char *expect_long_option_value(
+    const char *const name,
+    const char *value,
+    const int argc,
+    const char *const *const argv,
+    int &i
+) {
+    if (value == nullptr) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Expected argument for `--%s`\n", name);
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        value = argv[++i];
+    }
+    if (value[0] == '\0') {
+        fprintf(stderr, "Argument for `--%s` cannot be empty\n", name);
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+    return value;
+}
+
+// Positive decimal integer
+uint64_t expect_long_option_integer(const char *const name, const char *value) {
+    uint64_t number = 0;
+    for (size_t i = 0; value[i] != '\0'; ++i) {
+        const char ch = value[i];
+        if (ch < '0' || ch > '9' || number > UINT64_MAX / 10) {
+            fprintf(stderr, "Expected integer argument for `--%s`\n", name);
+            print_usage_hint();
+            exit(static_cast<int>(Error::CLI));
+        }
+        number = number * 10 + (ch - '0');
+    }
+    if (number == 0) {
+        fprintf(stderr, "Argument for `--%s` must be positive\n", name);
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+    return number;
+}
+
+// For flags, which cannot be given `--NAME=VALUE`
+void expect_no_long_option_value(const char *const name, const char *value) {
+    if (value != nullptr) {
+        fprintf(stderr, "Unexpected argument for `--%s`\n", name);
+        print_usage_hint();
+        exit(static_cast<int>(Error::CLI));
+    }
+}
+
 void print_usage_hint() {
     fprintf(stderr, "Use `" PROGRAM_NAME " -h` to show usage\n");
 }
@@ -257,17 +707,82 @@ void print_usage() {
         "USAGE:\n"
         "    " PROGRAM_NAME
         " -h [-ax] [INPUT] [-o OUTPUT]\n"
+        "    " PROGRAM_NAME
+        " --serve SOCKET\n"
+        "    " PROGRAM_NAME
+        " --trace-query TRACE [INPUT | --symbols FILE]\n"
+        "    " PROGRAM_NAME
+        " --snapshot SNAPSHOT [INPUT | --symbols FILE]\n"
+        "    " PROGRAM_NAME
+        " --fuzz OBJECT CORPUS [--fuzz-runs N]\n"
         "MODE:\n"
         "    (default)      Assemble + Execute\n"
         "    -a             Assembly only\n"
         "    -x             Execute only\n"
+        "    --serve SOCKET Run jobs from a Unix domain socket\n"
+        "    --snapshot SNAPSHOT\n"
+        "                   Resume from SNAPSHOT, with labels from INPUT if\n"
+        "                   given\n"
+        "    --fuzz OBJECT  Run OBJECT with generated input, keeping inputs\n"
+        "                   which reach new branches in directory CORPUS,\n"
+        "                   and saving those which fail or hang\n"
+        "    --fuzz-runs N  Stop fuzzing after N runs, not on SIGINT\n"
         "ARGUMENTS:\n"
         "        [INPUT]    Input filename (.asm, or .obj for -x)\n"
         "                   Use '-' to read input from stdin\n"
         "    -o [OUTPUT]    Output filename\n"
         "                   Use '-' to write output to stdout (with -a)\n"
+        "    --symbols FILE Write labels and source lines to FILE when\n"
+        "                   assembling, or read them from FILE otherwise\n"
         "    -d             Debug program execution\n"
-        "    -q             Minimize debugger output"
+        "    -q             Minimize debugger output\n"
+        "    --debug-script FILE\n"
+        "                   Debug with commands from FILE, without prompts\n"
+        "                   or terminal control (implies -d)\n"
+        "    --save-snapshot FILE\n"
+        "                   Save machine state to FILE on HALT, DEBUG trap\n"
+        "                   (stopping there), SIGINT, or SIGTERM\n"
+        "    --crash-dump FILE\n"
+        "                   Where to save machine state if execution fails\n"
+        "                   (default $TMPDIR/lasim.crash, only if stderr is\n"
+        "                   a terminal), for `--snapshot FILE -d`\n"
+        "    --no-crash-dump\n"
+        "                   Do not save machine state if execution fails\n"
+        "    --reverse-log N\n"
+        "                   Debugger can reverse the last N instructions\n"
+        "                   (`rstep` and `rcont`, which a debug script\n"
+        "                   enables with N of 65536)\n"
+        "LIMITS:\n"
+        "    --max-instructions N   Fail if not halted after N instructions\n"
+        "    --max-output N         Fail if more than N bytes are printed\n"
+        "    --max-time MS          Fail if not halted after MS milliseconds\n"
+        "    --detect-loops         Fail if program state repeats\n"
+        "ANALYSIS:\n"
+        "    --profile              Print execution counts after program ends\n"
+        "    --callgraph FILE       Print counts per subroutine after program\n"
+        "                           ends, and write folded stacks to FILE\n"
+        "    --heatmap FILE         Print memory accesses and working set\n"
+        "                           after program ends, and write accesses\n"
+        "                           per address to FILE (.pgm image, or CSV)\n"
+        "    --icache SPEC          Simulate instruction cache\n"
+        "    --dcache SPEC          Simulate data cache\n"
+        "                           SPEC is comma-separated, all optional:\n"
+        "                           size=WORDS,line=WORDS,ways=N,\n"
+        "                           replace=lru|fifo,write=back|through\n"
+        "    --bpred KIND           Simulate branch predictor, and print\n"
+        "                           outcomes per branch (KIND is static,\n"
+        "                           bimodal, or gshare)\n"
+        "    --pipeline[=SPEC]      Count cycles of a 5-stage pipeline, and\n"
+        "                           print stalls per instruction\n"
+        "                           SPEC is comma-separated, all optional:\n"
+        "                           load=CYCLES,branch=CYCLES,memory=CYCLES\n"
+        "    --trace FILE           Record every executed instruction to FILE\n"
+        "    --coverage[=FILE]      Print executed source lines, merging\n"
+        "                           executed addresses with bitmap FILE\n"
+        "    --lcov FILE            Write line coverage to FILE, as lcov\n"
+        "    --trace-query TRACE    Answer queries from stdin about TRACE,\n"
+        "                           with labels from INPUT if given\n"
+        "                           (use query `help` to list queries)\n"
         "OPTIONS:\n"
         "    -h             Print usage\n"
         ""
@@ -309,4 +824,7 @@ void copy_filename_with_extension(char *const dest, const char *const src) {
     dest[last_period + DEFAULT_OUT_EXTENSION_SIZE] = '\0';
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
@@ -0,0 +1,356 @@
+#ifndef CONDITION_CPP
+#define CONDITION_CPP
+
+#include <cctype>  // isspace
+#include <vector>  // std::vector
+
+#include "globals.hpp"
+#include "slice.cpp"
+#include "symbols.cpp"
+#include "token.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Breakpoint conditions, such as `R1 == 0 && mem[x4000] > 5`
+//
+// A condition is parsed once into bytecode for a small stack machine, so
+//     checking it at each breakpoint hit is a short loop over words.
+//
+// Operators, from lowest precedence:
+//     ||
+//     &&
+//     ==  !=  <  <=  >  >=   (signed, like LC-3 arithmetic)
+//     +  -
+//     !  -   (unary)
+// Operands are integers, labels (as addresses), `R0`-`R7`, `PC`, `mem[...]`,
+//     and parenthesized expressions. Non-zero is true.
+
+// Deep enough for any reasonable condition
+#define CONDITION_STACK_SIZE 16
+
+// Each is one word, and `PUSH` is followed by its value
+enum class ConditionOp {
+    PUSH,
+    REGISTER_0,  // Consecutive, so `REGISTER_0 + reg`
+    REGISTER_1,
+    REGISTER_2,
+    REGISTER_3,
+    REGISTER_4,
+    REGISTER_5,
+    REGISTER_6,
+    REGISTER_7,
+    PC,
+    LOAD,
+    ADD,
+    SUBTRACT,
+    NEGATE,
+    NOT,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    AND,
+    OR,
+};
+
+typedef struct ConditionParser {
+    const char *line;
+    vector<Word> &code;
+    // Stack depth after code so far, and highest
+    int depth;
+    int max_depth;
+    const char *error;  // `nullptr` if valid
+} ConditionParser;
+
+// Returns message if invalid, otherwise `nullptr`
+// `line` is moved past the condition
+const char *compile_condition(const char *&line, vector<Word> &code);
+bool evaluate_condition(const vector<Word> &code);
+
+static Word apply_condition_binary(
+    const ConditionOp op, const Word left, const Word right
+);
+static void parse_condition_or(ConditionParser &parser);
+static void parse_condition_and(ConditionParser &parser);
+static void parse_condition_comparison(ConditionParser &parser);
+static void parse_condition_sum(ConditionParser &parser);
+static void parse_condition_unary(ConditionParser &parser);
+static void parse_condition_operand(ConditionParser &parser);
+static bool take_condition_symbol(
+    ConditionParser &parser, const char *const symbol
+);
+static void emit_condition_op(
+    ConditionParser &parser, const ConditionOp op, const int depth_change
+);
+
+const char *compile_condition(const char *&line, vector<Word> &code) {
+    code.clear();
+    ConditionParser parser = {line, code, 0, 0, nullptr};
+    parse_condition_or(parser);
+    if (parser.error == nullptr && parser.max_depth > CONDITION_STACK_SIZE)
+        parser.error = "Condition is too complex";
+    line = parser.line;
+    return parser.error;
+}
+
+bool evaluate_condition(const vector<Word> &code) {
+    Word stack[CONDITION_STACK_SIZE];
+    size_t top = 0;  // Amount of values
+    const Registers &registers = machine->registers;
+
+    for (size_t i = 0; i < code.size(); ++i) {
+        const ConditionOp op = static_cast<ConditionOp>(code[i]);
+        switch (op) {
+            case ConditionOp::PUSH:
+                stack[top++] = code[++i];
+                break;
+            case ConditionOp::PC:
+                stack[top++] = registers.program_counter;
+                break;
+            case ConditionOp::LOAD:
+                stack[top - 1] = machine->memory[stack[top - 1]];
+                break;
+            case ConditionOp::NEGATE:
+                stack[top - 1] = static_cast<Word>(-stack[top - 1]);
+                break;
+            case ConditionOp::NOT:
+                stack[top - 1] = stack[top - 1] == 0;
+                break;
+            default:
+                if (op <= ConditionOp::REGISTER_7) {
+                    const size_t reg =
+                        code[i] - static_cast<Word>(ConditionOp::REGISTER_0);
+                    stack[top++] = registers.general_purpose[reg];
+                } else {
+                    --top;
+                    stack[top - 1] = apply_condition_binary(
+                        op, stack[top - 1], stack[top]
+                    );
+                }
+                break;
+        }
+    }
+    return top > 0 && stack[top - 1] != 0;
+}
+
+// Comparisons are signed
+static Word apply_condition_binary(
+    const ConditionOp op, const Word left, const Word right
+) {
+    const SignedWord a = static_cast<SignedWord>(left);
+    const SignedWord b = static_cast<SignedWord>(right);
+    switch (op) {
+        case ConditionOp::ADD:
+            return static_cast<Word>(a + b);
+        case ConditionOp::SUBTRACT:
+            return static_cast<Word>(a - b);
+        case ConditionOp::EQUAL:
+            return a == b;
+        case ConditionOp::NOT_EQUAL:
+            return a != b;
+        case ConditionOp::LESS:
+            return a < b;
+        case ConditionOp::LESS_EQUAL:
+            return a <= b;
+        case ConditionOp::GREATER:
+            return a > b;
+        case ConditionOp::GREATER_EQUAL:
+            return a >= b;
+        case ConditionOp::AND:
+            return a != 0 && b != 0;
+        case ConditionOp::OR:
+            return a != 0 || b != 0;
+        default:
+            return 0;
+    }
+}
+
+static void parse_condition_or(ConditionParser &parser) {
+    parse_condition_and(parser);
+    while (parser.error == nullptr && take_condition_symbol(parser, "||")) {
+        parse_condition_and(parser);
+        emit_condition_op(parser, ConditionOp::OR, -1);
+    }
+}
+
+static void parse_condition_and(ConditionParser &parser) {
+    parse_condition_comparison(parser);
+    while (parser.error == nullptr && take_condition_symbol(parser, "&&")) {
+        parse_condition_comparison(parser);
+        emit_condition_op(parser, ConditionOp::AND, -1);
+    }
+}
+
+static void parse_condition_comparison(ConditionParser &parser) {
+    parse_condition_sum(parser);
+    if (parser.error != nullptr)
+        return;
+
+    // Longer symbols first, so `<=` is not taken as `<`
+    ConditionOp op;
+    if (take_condition_symbol(parser, "=="))
+        op = ConditionOp::EQUAL;
+    else if (take_condition_symbol(parser, "!="))
+        op = ConditionOp::NOT_EQUAL;
+    else if (take_condition_symbol(parser, "<="))
+        op = ConditionOp::LESS_EQUAL;
+    else if (take_condition_symbol(parser, ">="))
+        op = ConditionOp::GREATER_EQUAL;
+    else if (take_condition_symbol(parser, "<"))
+        op = ConditionOp::LESS;
+    else if (take_condition_symbol(parser, ">"))
+        op = ConditionOp::GREATER;
+    else
+        return;
+
+    parse_condition_sum(parser);
+    emit_condition_op(parser, op, -1);
+}
+
+static void parse_condition_sum(ConditionParser &parser) {
+    parse_condition_unary(parser);
+    while (parser.error == nullptr) {
+        ConditionOp op;
+        if (take_condition_symbol(parser, "+"))
+            op = ConditionOp::ADD;
+        else if (take_condition_symbol(parser, "-"))
+            op = ConditionOp::SUBTRACT;
+        else
+            return;
+        parse_condition_unary(parser);
+        emit_condition_op(parser, op, -1);
+    }
+}
+
+static void parse_condition_unary(ConditionParser &parser) {
+    // `!=` is not unary, but is never at the start of an operand
+    if (take_condition_symbol(parser, "!")) {
+        parse_condition_unary(parser);
+        emit_condition_op(parser, ConditionOp::NOT, 0);
+        return;
+    }
+    // Negative integer is an operand, not negation of one
+    const char *line = parser.line;
+    while (isspace(line[0]))
+        ++line;
+    if (line[0] == '-' && !(line[1] >= '0' && line[1] <= '9') &&
+        line[1] != 'x' && line[1] != 'X' && line[1] != '#') {
+        parser.line = line + 1;
+        parse_condition_unary(parser);
+        emit_condition_op(parser, ConditionOp::NEGATE, 0);
+        return;
+    }
+    parse_condition_operand(parser);
+}
+
+static void parse_condition_operand(ConditionParser &parser) {
+    if (parser.error != nullptr)
+        return;
+    const char *&line = parser.line;
+    while (isspace(line[0]))
+        ++line;
+
+    if (take_condition_symbol(parser, "(")) {
+        parse_condition_or(parser);
+        if (parser.error == nullptr && !take_condition_symbol(parser, ")"))
+            parser.error = "Expected `)`";
+        return;
+    }
+
+    InitialSignWord integer;
+    const int result = take_integer(line, integer);
+    if (result == -1) {
+        parser.error = "Invalid integer";
+        return;
+    }
+    if (result == 1) {
+        emit_condition_op(parser, ConditionOp::PUSH, 1);
+        parser.code.push_back(integer.value);
+        return;
+    }
+
+    StringSlice name = {line, 0};
+    while (is_char_valid_in_identifier(line[name.length]))
+        ++name.length;
+    if (name.length == 0) {
+        parser.error = "Expected operand";
+        return;
+    }
+    line += name.length;
+
+    const char first = name.pointer[0];
+    const char second = name.pointer[1];
+    if (name.length == 2 && (first == 'r' || first == 'R') && second >= '0' &&
+        second < '0' + GP_REGISTER_COUNT) {
+        const Word reg = second - '0';
+        emit_condition_op(
+            parser,
+            static_cast<ConditionOp>(
+                static_cast<Word>(ConditionOp::REGISTER_0) + reg
+            ),
+            1
+        );
+        return;
+    }
+    if (string_equals_slice("pc", name)) {
+        emit_condition_op(parser, ConditionOp::PC, 1);
+        return;
+    }
+    if (string_equals_slice("mem", name)) {
+        if (!take_condition_symbol(parser, "[")) {
+            parser.error = "Expected `[` after `mem`";
+            return;
+        }
+        parse_condition_or(parser);
+        if (parser.error == nullptr && !take_condition_symbol(parser, "]"))
+            parser.error = "Expected `]`";
+        emit_condition_op(parser, ConditionOp::LOAD, 0);
+        return;
+    }
+
+    const Symbol *const symbol = find_symbol(name);
+    if (symbol == nullptr) {
+        parser.error = "Unknown label";
+        return;
+    }
+    emit_condition_op(parser, ConditionOp::PUSH, 1);
+    parser.code.push_back(symbol->address);
+}
+
+// Skips whitespace, then takes `symbol` if it is next
+static bool take_condition_symbol(
+    ConditionParser &parser, const char *const symbol
+) {
+    const char *line = parser.line;
+    while (isspace(line[0]))
+        ++line;
+    size_t i = 0;
+    for (; symbol[i] != '\0'; ++i) {
+        if (line[i] != symbol[i])
+            return false;
+    }
+    parser.line = line + i;
+    return true;
+}
+
+static void emit_condition_op(
+    ConditionParser &parser, const ConditionOp op, const int depth_change
+) {
+    if (parser.error != nullptr)
+        return;
+    parser.code.push_back(static_cast<Word>(op));
+    parser.depth += depth_change;
+    if (parser.depth > parser.max_depth)
+        parser.max_depth = parser.depth;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef COVERAGE_CPP
+#define COVERAGE_CPP
+
+#include <fcntl.h>     // open
+#include <sys/file.h>  // flock
+#include <unistd.h>    // close, pread, pwrite
+
+#include <cstdio>   // fprintf, fopen
+#include <cstring>  // memcmp, memcpy
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "symbols.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Bitmap file format:
+//     `COVERAGE_MAGIC` (8 bytes, including version)
+//     One bit per address (`COVERAGE_BITMAP_SIZE` bytes), bit `address % 8`
+//         of byte `address / 8`, set if an instruction there was executed
+// An existing file is merged (bitwise OR) with this run, so running each input
+//     of a test suite with the same file gives coverage of the whole suite
+// The file is locked while it is merged, so runs can be concurrent
+#define COVERAGE_MAGIC "LCCOVER\x01"
+#define COVERAGE_MAGIC_SIZE 8
+#define COVERAGE_BITMAP_SIZE (MEMORY_SIZE / 8)
+
+// Uncovered line ranges per row of report
+#define COVERAGE_RANGES_PER_ROW 8
+
+// Executed addresses, reported per source line
+typedef struct Coverage {
+    bool is_enabled = false;
+    // Opened when enabled, so errors are reported early
+    int bitmap_fd;    // -1 if not merged with a file
+    FILE *lcov_file;  // `nullptr` if not written
+    const char *bitmap_filename;
+    // Byte per address, rather than bit, so marking is a single store
+    vector<uint8_t> executed;  // `MEMORY_SIZE` once enabled
+} Coverage;
+
+static Coverage coverage;
+
+// Source line with at least one instruction
+typedef struct CoverageLine {
+    int number;
+    bool is_covered;
+} CoverageLine;
+
+// Either filename may be `nullptr`
+void enable_coverage(
+    const char *const bitmap_filename,
+    const char *const lcov_filename,
+    Error &error
+);
+void coverage_instruction(const Word pc);
+void print_coverage(FILE *const file);
+
+static void merge_coverage_bitmap(void);
+static void collect_coverage_lines(vector<CoverageLine> &lines);
+static void print_coverage_lines(FILE *const file);
+static void write_coverage_lcov(FILE *const file);
+
+void enable_coverage(
+    const char *const bitmap_filename,
+    const char *const lcov_filename,
+    Error &error
+) {
+    coverage.bitmap_fd = -1;
+    coverage.lcov_file = nullptr;
+    coverage.bitmap_filename = bitmap_filename;
+    if (bitmap_filename != nullptr) {
+        coverage.bitmap_fd = open(bitmap_filename, O_RDWR | O_CREAT, 0644);
+        if (coverage.bitmap_fd < 0) {
+            fprintf(
+                stderr, "Failed to open coverage file: %s\n", bitmap_filename
+            );
+            SET_ERROR(error, FILE);
+            return;
+        }
+    }
+    if (lcov_filename != nullptr) {
+        coverage.lcov_file = fopen(lcov_filename, "w");
+        if (coverage.lcov_file == nullptr) {
+            fprintf(
+                stderr,
+                "Failed to open lcov file for writing: %s\n",
+                lcov_filename
+            );
+            SET_ERROR(error, FILE);
+            return;
+        }
+    }
+
+    coverage.is_enabled = true;
+    coverage.executed.assign(MEMORY_SIZE, 0);
+}
+
+void coverage_instruction(const Word pc) {
+    coverage.executed[pc] = 1;
+}
+
+// Report, merge bitmap file, and write lcov file
+// Report includes other runs merged into the bitmap file
+void print_coverage(FILE *const file) {
+    if (coverage.bitmap_fd >= 0)
+        merge_coverage_bitmap();
+
+    size_t executed_count = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i)
+        executed_count += coverage.executed[i];
+    fprintf(file, "\nCoverage: %zu addresses executed", executed_count);
+    if (coverage.bitmap_fd >= 0)
+        fprintf(file, " (merged into %s)", coverage.bitmap_filename);
+    fprintf(file, "\n");
+
+    if (symbols.is_loaded)
+        print_coverage_lines(file);
+    else
+        fprintf(file, "Source lines are unknown\n");
+
+    if (coverage.lcov_file != nullptr) {
+        if (symbols.is_loaded)
+            write_coverage_lcov(coverage.lcov_file);
+        else
+            fprintf(file, "Cannot write lcov file without source lines\n");
+        if (fclose(coverage.lcov_file) != 0)
+            fprintf(file, "Failed to write lcov file\n");
+    }
+}
+
+// Failure is reported, and leaves the file unchanged
+static void merge_coverage_bitmap() {
+    const int fd = coverage.bitmap_fd;
+    uint8_t data[COVERAGE_MAGIC_SIZE + COVERAGE_BITMAP_SIZE];
+    // Held until closed
+    flock(fd, LOCK_EX);
+
+    // Empty if just created
+    const ssize_t size = pread(fd, data, sizeof(data), 0);
+    if (size > 0) {
+        if (size != sizeof(data) ||
+            memcmp(data, COVERAGE_MAGIC, COVERAGE_MAGIC_SIZE) != 0) {
+            fprintf(
+                stderr,
+                "Invalid coverage file, not merged: %s\n",
+                coverage.bitmap_filename
+            );
+            close(fd);
+            coverage.bitmap_fd = -1;
+            return;
+        }
+        const uint8_t *const bits = data + COVERAGE_MAGIC_SIZE;
+        for (size_t i = 0; i < MEMORY_SIZE; ++i)
+            coverage.executed[i] |= bits[i / 8] >> (i % 8) & 1;
+    }
+
+    memcpy(data, COVERAGE_MAGIC, COVERAGE_MAGIC_SIZE);
+    uint8_t *const bits = data + COVERAGE_MAGIC_SIZE;
+    memset(bits, 0, COVERAGE_BITMAP_SIZE);
+    for (size_t i = 0; i < MEMORY_SIZE; ++i)
+        bits[i / 8] |= coverage.executed[i] << (i % 8);
+    bool is_written = pwrite(fd, data, sizeof(data), 0) ==
+                      static_cast<ssize_t>(sizeof(data));
+    if (close(fd) != 0)
+        is_written = false;
+    if (!is_written) {
+        fprintf(
+            stderr,
+            "Failed to write coverage file: %s\n",
+            coverage.bitmap_filename
+        );
+        coverage.bitmap_fd = -1;
+    }
+}
+
+// Lines with instructions, in order of address
+// A line is covered if any of its instructions was executed
+static void collect_coverage_lines(vector<CoverageLine> &lines) {
+    lines.clear();
+    for (size_t i = 0; i < symbols.line_numbers.size(); ++i) {
+        if (!symbols.is_instruction[i])
+            continue;
+        const int number = symbols.line_numbers[i];
+        const Word address = static_cast<Word>(symbols.origin + i);
+        const bool is_executed = coverage.executed[address] != 0;
+        // Words of a line are consecutive
+        if (!lines.empty() && lines.back().number == number)
+            lines.back().is_covered = lines.back().is_covered || is_executed;
+        else
+            lines.push_back({number, is_executed});
+    }
+}
+
+// Consecutive uncovered lines are listed as a range
+static void print_coverage_lines(FILE *const file) {
+    vector<CoverageLine> lines;
+    collect_coverage_lines(lines);
+    size_t covered_line_count = 0;
+    for (size_t i = 0; i < lines.size(); ++i)
+        covered_line_count += lines[i].is_covered;
+
+    fprintf(
+        file,
+        "Lines: %zu of %zu (%.1f%%)\n",
+        covered_line_count,
+        lines.size(),
+        lines.size() > 0 ? 100.0 * covered_line_count / lines.size() : 100.0
+    );
+    if (covered_line_count == lines.size())
+        return;
+
+    fprintf(file, "\nUncovered lines:");
+    size_t range_count = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].is_covered)
+            continue;
+        const int start = lines[i].number;
+        while (i + 1 < lines.size() && !lines[i + 1].is_covered)
+            ++i;
+        if (range_count % COVERAGE_RANGES_PER_ROW == 0)
+            fprintf(file, "\n   ");
+        ++range_count;
+        fprintf(file, " %d", start);
+        if (lines[i].number != start)
+            fprintf(file, "-%d", lines[i].number);
+    }
+    fprintf(file, "\n");
+}
+
+// Tracefile for `genhtml` and other lcov tools
+// Counts are 0 or 1, as only the bitmap is kept
+static void write_coverage_lcov(FILE *const file) {
+    vector<CoverageLine> lines;
+    collect_coverage_lines(lines);
+    size_t covered_line_count = 0;
+    fprintf(file, "TN:\nSF:%s\n", symbols.filename);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        fprintf(file, "DA:%d,%d\n", lines[i].number, lines[i].is_covered);
+        covered_line_count += lines[i].is_covered;
+    }
+    fprintf(
+        file,
+        "LF:%zu\nLH:%zu\nend_of_record\n",
+        lines.size(),
+        covered_line_count
+    );
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -1,14 +1,27 @@
 #ifndef DEBUGGER_CPP
 #define DEBUGGER_CPP
 
-#include <cstdio>  // fprintf, getchar
+#include <cctype>   // isdigit, isspace
+#include <cstdint>  // UINT64_MAX
+#include <cstdio>   // fprintf, getchar, fopen, fgets
+#include <cstring>  // strlen
+#include <vector>   // std::vector
 
+#include "condition.cpp"
+#include "error.hpp"
 #include "globals.hpp"
+#include "instrument.cpp"
+#include "machine.cpp"
+#include "reverse.cpp"
 #include "slice.cpp"
+#include "symbols.cpp"
 #include "token.cpp"
 #include "tty.cpp"
 #include "types.hpp"
 
+namespace lasim {
+namespace internal {
+
 // TODO(feat): Overhaul debugger commands:
 // Not all have to be added
 //    reg           show all registers
@@ -22,24 +35,26 @@
 //    trap t        simulate trap
 //    halt          simulate HALT
 //    step n        execute next instruction
-//    next          execute next instruction or subroutine
+//    reverse-step  undo last instruction (implemented)
+//    next          execute next instruction or subroutine (implemented)
 //    continue      continue till next HALT or breakpoint
-//    finish        execute to end of current subroutine
+//    finish        execute to end of current subroutine (implemented)
 //    quit          quit debugger, continue execution
 //    exit          quit debugger and executor
-// TODO(feat): How would these debugger commands work?
-//    break?     set/remove breakpoint
-
-// TODO(feat): Keep track of labels for debugger
-//     Maybe make label_definitions list global/static
-//     A symbol table file seems more hassle than it's worth
+//    break a [if c] [hit-count n]
+//                  set breakpoint at address/label (implemented)
+//    delete a      remove breakpoint at address/label (implemented)
+//    watch a [b]   suspend when address/range is written (implemented)
 
 // TODO(refactor): Create header file for execute.cpp or extract functions
 void print_on_new_line(void);
 static char *halfbyte_string(const Word word);
 
-#define MAX_DEBUGGER_COMMAND 20  // Includes '\0'
+// Long enough for a breakpoint with a condition
+#define MAX_DEBUGGER_COMMAND 128  // Includes '\0'
 #define MAX_DEBUGGER_HISTORY 4
+// Deeper calls are not tracked, such as when `JSR` is used as a jump
+#define MAX_DEBUGGER_CALL_DEPTH 1024
 
 #define stddbg stderr
 
@@ -55,14 +70,24 @@ static char *halfbyte_string(const Word word);
             fflush(stddbg);               \
         }                                 \
     }
-#define dprintfc(...)                        \
-    {                                        \
-        if (!debugger_quiet) {               \
-            fprintf(stddbg, DEBUGGER_COLOR); \
-            fprintf(stddbg, __VA_ARGS__);    \
-            fprintf(stddbg, "\x1b[0m");      \
-            fflush(stddbg);                  \
-        }                                    \
+#define dprintfc(...)                            \
+    {                                            \
+        if (!debugger_quiet) {                   \
+            if (!debug_script.is_enabled)        \
+                fprintf(stddbg, DEBUGGER_COLOR); \
+            fprintf(stddbg, __VA_ARGS__);        \
+            if (!debug_script.is_enabled)        \
+                fprintf(stddbg, "\x1b[0m");      \
+            fflush(stddbg);                      \
+        }                                        \
+    }
+// Escape codes and decoration, only shown interactively
+#define dprintf_style(...)                                  \
+    {                                                       \
+        if (!debugger_quiet && !debug_script.is_enabled) { \
+            fprintf(stddbg, __VA_ARGS__);                   \
+            fflush(stddbg);                                 \
+        }                                                   \
     }
 #define dprintfc_always(...)          \
     {                                 \
@@ -74,6 +99,19 @@ static char *halfbyte_string(const Word word);
 // TODO(refactor): Maybe make all debugger state in a separate static object
 static bool debugger_quiet = false;
 
+// Commands from `--debug-script`, read before execution
+// Each is stored with a '\0' after it, and run without prompt or terminal
+//     control, so output is plain text
+typedef struct DebugScript {
+    bool is_enabled = false;
+    vector<char> text;
+    vector<size_t> starts;  // Offset of each command in `text`
+    size_t next;
+    bool has_reverse;  // Needs undo log
+} DebugScript;
+
+static DebugScript debug_script;
+
 // Only for debugger commands which affect program control-flow
 enum class DebuggerAction {
     NONE,      // No control-flow action taken
@@ -96,13 +134,76 @@ typedef struct CommandHistory {
 
 static CommandHistory history;
 
+// Bit per address, set by `break` and cleared by `delete`
+// Only checked while debugging, so a normal run is unaffected
+static uint64_t breakpoint_bits[MEMORY_SIZE / 64];
+
+// Breakpoint at an address with its bit set
+typedef struct Breakpoint {
+    Word addr;
+    // Compiled condition, or empty if always true
+    vector<Word> condition;
+    char condition_text[MAX_DEBUGGER_COMMAND];
+    // Suspend once condition is true this many times, or 0 for first time
+    uint64_t hit_count;
+    uint64_t hits;
+} Breakpoint;
+
+static vector<Breakpoint> breakpoints;
+
+// Bit per address, set by `watch` (writes) and `awatch` (reads and writes)
+// Only checked if `has_watchpoints`, so a normal run pays a single branch
+static uint64_t watch_write_bits[MEMORY_SIZE / 64];
+static uint64_t watch_read_bits[MEMORY_SIZE / 64];
+static bool has_watchpoints = false;
+
+// First watched access by current instruction, reported once it completes
+typedef struct WatchHit {
+    bool is_hit = false;
+    bool is_write;
+    Word pc;
+    Word addr;
+    Word old;
+    Word value;  // Same as `old` for a read
+} WatchHit;
+
+static WatchHit watch_hit;
+
+// Return addresses of subroutines called while debugging, for `finish`
+static vector<Word> call_stack;
+// Set once the program continued unchecked, so earlier calls are not known
+static bool is_call_stack_forgotten = false;
+
+// Set by `next` and `finish`, and cleared once the debugger prompts
+// Checked while continuing, like a breakpoint, so the subroutine runs at full
+//     speed instead of prompting for each instruction
+typedef struct TemporaryBreakpoint {
+    bool is_set = false;
+    Word addr;
+    // Call stack size once returned, so a recursive call to the same address
+    //     does not suspend
+    size_t depth;
+} TemporaryBreakpoint;
+
+static TemporaryBreakpoint temporary_breakpoint;
+
 enum class DebuggerCommand {
     UNKNOWN,
     REGISTERS,
     STEP,
+    NEXT,
+    FINISH,
     CONTINUE,
     MEMORY_GET,
     MEMORY_SET,
+    BREAK,
+    DELETE,
+    WATCH,
+    ACCESS_WATCH,
+    UNWATCH,
+    REVERSE_STEP,
+    REVERSE_CONTINUE,
+    HISTORY,
     QUIT,
     STOP,
 };
@@ -113,7 +214,28 @@ enum class DebuggerCommand {
 // TODO(refactor): Use namespace ?
 
 void print_registers(FILE *const file);
-char condition_char(ConditionCode condition);
+void print_registers_line(FILE *const file);
+void load_debug_script(const char *const filename, Error &error);
+void reverse_execution(const bool is_continue);
+bool is_breakpoint_address(const Word addr);
+bool breakpoint_matches(const Word addr, const bool count_hit);
+void set_breakpoint(const char *&line);
+void delete_breakpoint(const Word addr);
+bool is_breakpoint_instruction(const Word addr);
+void print_breakpoints(void);
+void set_watchpoints(
+    const Word start, const Word end, const DebuggerCommand command
+);
+void print_watchpoints(void);
+void check_watchpoint(const Word addr, const Word value, const bool is_write);
+bool report_watch_hit(void);
+void track_call(const Word pc, const Word instr);
+bool is_temporary_breakpoint_reached(void);
+bool is_continue_checked(void);
+void forget_call_stack(void);
+void print_pc_history(void);
+
+static void untrack_call(const Word next_pc);
 
 void push_history(const char *const buffer) {
     if (history.length >= MAX_DEBUGGER_HISTORY) {
@@ -219,12 +341,6 @@ bool read_line(char *const buffer) {
     return true;
 }
 
-void take_whitespace(const char *&line) {
-    // Ignore leading spaces
-    while (isspace(line[0]))
-        ++line;
-}
-
 DebuggerCommand take_command(const char *&line) {
     StringSlice command;
     take_whitespace(line);
@@ -245,6 +361,14 @@ DebuggerCommand take_command(const char *&line) {
         string_equals_slice("step", command)) {
         return DebuggerCommand::STEP;
     }
+    if (string_equals_slice("n", command) ||
+        string_equals_slice("next", command)) {
+        return DebuggerCommand::NEXT;
+    }
+    if (string_equals_slice("f", command) ||
+        string_equals_slice("finish", command)) {
+        return DebuggerCommand::FINISH;
+    }
     if (string_equals_slice("c", command) ||
         string_equals_slice("cont", command) ||
         string_equals_slice("continue", command)) {
@@ -264,6 +388,38 @@ DebuggerCommand take_command(const char *&line) {
         string_equals_slice("memoryset", command)) {
         return DebuggerCommand::MEMORY_SET;
     }
+    if (string_equals_slice("b", command) ||
+        string_equals_slice("break", command)) {
+        return DebuggerCommand::BREAK;
+    }
+    if (string_equals_slice("d", command) ||
+        string_equals_slice("delete", command)) {
+        return DebuggerCommand::DELETE;
+    }
+    if (string_equals_slice("w", command) ||
+        string_equals_slice("watch", command)) {
+        return DebuggerCommand::WATCH;
+    }
+    if (string_equals_slice("aw", command) ||
+        string_equals_slice("awatch", command)) {
+        return DebuggerCommand::ACCESS_WATCH;
+    }
+    if (string_equals_slice("uw", command) ||
+        string_equals_slice("unwatch", command)) {
+        return DebuggerCommand::UNWATCH;
+    }
+    if (string_equals_slice("rstep", command) ||
+        string_equals_slice("reverse-step", command)) {
+        return DebuggerCommand::REVERSE_STEP;
+    }
+    if (string_equals_slice("rcont", command) ||
+        string_equals_slice("reverse-continue", command)) {
+        return DebuggerCommand::REVERSE_CONTINUE;
+    }
+    if (string_equals_slice("hist", command) ||
+        string_equals_slice("history", command)) {
+        return DebuggerCommand::HISTORY;
+    }
     if (string_equals_slice("q", command) ||
         string_equals_slice("quit", command)) {
         return DebuggerCommand::QUIT;
@@ -283,13 +439,45 @@ bool expect_address(const char *&line, Word &addr) {
     }
     addr = integer.value;
     // Reflects `memory_checked`
-    if (addr < memory_file_bounds.start || addr > MEMORY_USER_MAX) {
+    if (addr < machine->memory_file_bounds.start || addr > MEMORY_USER_MAX) {
         dprintfc("Memory address is out of bounds\n");
         return false;
     }
     return true;
 }
 
+// Integer, or label if program was assembled in this process
+// Not bounds-checked, as a breakpoint may be anywhere
+bool expect_address_or_label(const char *&line, Word &addr) {
+    take_whitespace(line);
+    InitialSignWord integer;
+    if (take_integer(line, integer) == 1 && !integer.is_signed) {
+        addr = integer.value;
+        return true;
+    }
+
+    StringSlice name = {line, 0};
+    while (is_char_valid_in_identifier(line[name.length]))
+        ++name.length;
+    if (name.length == 0) {
+        dprintfc("Expected address or label argument\n");
+        return false;
+    }
+    const Symbol *const symbol = find_symbol(name);
+    if (symbol == nullptr) {
+        dprintfc("Unknown label\n");
+        return false;
+    }
+    line += name.length;
+    addr = symbol->address;
+    return true;
+}
+
+bool is_end_of_command(const char *line) {
+    take_whitespace(line);
+    return line[0] == '\0';
+}
+
 bool expect_integer(const char *&line, Word &value) {
     take_whitespace(line);
     InitialSignWord integer;
@@ -302,11 +490,33 @@ bool expect_integer(const char *&line, Word &value) {
     return true;
 }
 
+// Unsigned decimal, which may be larger than a word
+bool expect_count(const char *&line, uint64_t &value) {
+    take_whitespace(line);
+    value = 0;
+    size_t length = 0;
+    for (; isdigit(static_cast<unsigned char>(line[length])); ++length) {
+        const uint64_t digit = line[length] - '0';
+        if (value > (UINT64_MAX - digit) / 10) {
+            dprintfc("Count is too large\n");
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    const unsigned char next = static_cast<unsigned char>(line[length]);
+    if (length == 0 || (next != '\0' && !isspace(next))) {
+        dprintfc("Expected decimal count argument\n");
+        return false;
+    }
+    line += length;
+    return true;
+}
+
 void print_integer_value(Word value) {
     // TODO(refactor): Combine functionality with `print_registers`
     // TODO(feat): Show ascii repr. if applicable
     // TODO(feat): Show instruction name/opcode repr. if applicable
-    if (debugger_quiet) {
+    if (debugger_quiet || debug_script.is_enabled) {
         dprintfc_always("0x%04hx\n", value);
     } else {
         dprintfc("       HEX    UINT    INT\n");
@@ -314,17 +524,84 @@ void print_integer_value(Word value) {
     }
 }
 
+// Blank lines and lines starting with `#` are ignored
+// As when interactive, `,` also separates commands
+void load_debug_script(const char *const filename, Error &error) {
+    FILE *const file = fopen(filename, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open debugger script: %s\n", filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    debug_script.is_enabled = true;
+    debug_script.next = 0;
+    debug_script.has_reverse = false;
+    Command buffer;
+    size_t line_number = 0;
+    while (fgets(buffer, MAX_DEBUGGER_COMMAND, file) != nullptr) {
+        ++line_number;
+        const size_t length = strlen(buffer);
+        if (length == MAX_DEBUGGER_COMMAND - 1 && buffer[length - 1] != '\n') {
+            fprintf(
+                stderr,
+                "Debugger script line %zu is too long: %s\n",
+                line_number,
+                filename
+            );
+            fclose(file);
+            SET_ERROR(error, FILE);
+            return;
+        }
+
+        const char *line = buffer;
+        take_whitespace(line);
+        if (line[0] == '#')
+            continue;
+        while (line[0] != '\0') {
+            take_whitespace(line);
+            const size_t start = debug_script.text.size();
+            for (; line[0] != '\0' && line[0] != ',' && line[0] != '\n';
+                 ++line)
+                debug_script.text.push_back(line[0]);
+            if (line[0] != '\0')
+                ++line;
+            if (debug_script.text.size() == start)
+                continue;
+            debug_script.text.push_back('\0');
+            debug_script.starts.push_back(start);
+        }
+    }
+    fclose(file);
+
+    for (size_t i = 0; i < debug_script.starts.size(); ++i) {
+        const char *command = &debug_script.text[debug_script.starts[i]];
+        const DebuggerCommand kind = take_command(command);
+        if (kind == DebuggerCommand::REVERSE_STEP ||
+            kind == DebuggerCommand::REVERSE_CONTINUE)
+            debug_script.has_reverse = true;
+    }
+}
+
 DebuggerAction ask_debugger_command() {
     const char *line = nullptr;
+    Command line_buf;
 
-    while (true) {
-        Command line_buf;
-        line = line_buf;
-        // On EOF, continue without debugger
-        if (!read_line(line_buf))
+    if (debug_script.is_enabled) {
+        // On end of script, continue without debugger
+        if (debug_script.next >= debug_script.starts.size())
             return DebuggerAction::STOP;
-        if (line_buf[0] != '\0')
-            break;
+        line = &debug_script.text[debug_script.starts[debug_script.next]];
+        ++debug_script.next;
+    } else {
+        while (true) {
+            line = line_buf;
+            // On EOF, continue without debugger
+            if (!read_line(line_buf))
+                return DebuggerAction::STOP;
+            if (line_buf[0] != '\0')
+                break;
+        }
     }
 
     DebuggerCommand command = take_command(line);
@@ -333,7 +610,9 @@ DebuggerAction ask_debugger_command() {
 
     switch (command) {
         case DebuggerCommand::REGISTERS: {
-            if (!debugger_quiet) {
+            if (debug_script.is_enabled)
+                print_registers_line(stddbg);
+            else if (!debugger_quiet) {
                 dprintf(DEBUGGER_COLOR);
                 print_registers(stddbg);
             }
@@ -342,7 +621,7 @@ DebuggerAction ask_debugger_command() {
             Word addr;
             if (!expect_address(line, addr))
                 return DebuggerAction::NONE;
-            Word value = memory[addr];
+            Word value = machine->memory[addr];
             dprintfc("Value at address 0x%04hx:\n", addr);
             print_integer_value(value);
         }; break;
@@ -352,12 +631,104 @@ DebuggerAction ask_debugger_command() {
                 return DebuggerAction::NONE;
             if (!expect_integer(line, value))
                 return DebuggerAction::NONE;
-            memory[addr] = value;
+            machine->memory[addr] = value;
+            touch_memory(addr);
             dprintfc("Modified value at address 0x%04hx\n", addr);
         }; break;
         case DebuggerCommand::STEP:
             return DebuggerAction::STEP;
             break;
+        case DebuggerCommand::NEXT: {
+            // Other instructions (including traps) are a single step
+            const Word pc = machine->registers.program_counter;
+            const Opcode opcode =
+                static_cast<Opcode>(machine->memory[pc] >> 12);
+            if (opcode != Opcode::JSR_JSRR)
+                return DebuggerAction::STEP;
+            temporary_breakpoint.is_set = true;
+            temporary_breakpoint.addr = static_cast<Word>(pc + 1);
+            temporary_breakpoint.depth = call_stack.size();
+            return DebuggerAction::CONTINUE;
+        }; break;
+        case DebuggerCommand::FINISH: {
+            if (call_stack.empty() && is_call_stack_forgotten) {
+                dprintfc(
+                    "Subroutine is not known, as calls are not tracked "
+                    "while continuing without breakpoints\n"
+                );
+                return DebuggerAction::NONE;
+            }
+            if (call_stack.empty()) {
+                dprintfc("Not in a subroutine\n");
+                return DebuggerAction::NONE;
+            }
+            temporary_breakpoint.is_set = true;
+            temporary_breakpoint.addr = call_stack.back();
+            temporary_breakpoint.depth = call_stack.size() - 1;
+            return DebuggerAction::CONTINUE;
+        }; break;
+        case DebuggerCommand::BREAK: {
+            if (is_end_of_command(line)) {
+                print_breakpoints();
+                return DebuggerAction::NONE;
+            }
+            set_breakpoint(line);
+        }; break;
+        case DebuggerCommand::DELETE: {
+            if (is_end_of_command(line)) {
+                while (!breakpoints.empty())
+                    delete_breakpoint(breakpoints.back().addr);
+                dprintfc("Removed all breakpoints\n");
+                return DebuggerAction::NONE;
+            }
+            Word addr;
+            if (!expect_address_or_label(line, addr))
+                return DebuggerAction::NONE;
+            if (!is_breakpoint_address(addr)) {
+                dprintfc("No breakpoint at address 0x%04hx\n", addr);
+                return DebuggerAction::NONE;
+            }
+            delete_breakpoint(addr);
+            dprintfc("Removed breakpoint at address 0x%04hx\n", addr);
+        }; break;
+        case DebuggerCommand::WATCH:
+        case DebuggerCommand::ACCESS_WATCH:
+        case DebuggerCommand::UNWATCH: {
+            if (is_end_of_command(line)) {
+                if (command == DebuggerCommand::UNWATCH)
+                    set_watchpoints(0, MEMORY_SIZE - 1, command);
+                else
+                    print_watchpoints();
+                return DebuggerAction::NONE;
+            }
+            Word start, end;
+            if (!expect_address_or_label(line, start))
+                return DebuggerAction::NONE;
+            end = start;
+            if (!is_end_of_command(line) &&
+                !expect_address_or_label(line, end))
+                return DebuggerAction::NONE;
+            if (end < start) {
+                dprintfc("End of range is before start\n");
+                return DebuggerAction::NONE;
+            }
+            set_watchpoints(start, end, command);
+        }; break;
+        case DebuggerCommand::REVERSE_STEP:
+        case DebuggerCommand::REVERSE_CONTINUE: {
+            if (!undo_log.is_enabled) {
+                dprintfc(
+                    "Reverse execution is not enabled (use `--reverse-log N`)\n"
+                );
+                return DebuggerAction::NONE;
+            }
+            const bool is_continue =
+                command == DebuggerCommand::REVERSE_CONTINUE;
+            reverse_execution(is_continue);
+        }; break;
+        case DebuggerCommand::HISTORY:
+            print_pc_history();
+            break;
         case DebuggerCommand::CONTINUE:
             return DebuggerAction::CONTINUE;
             break;
@@ -371,7 +742,18 @@ DebuggerAction ask_debugger_command() {
                 "    h      Print usage\n"
                 "    r      Print registers\n"
                 "    s      Execute next instruction\n"
+                "    n      Execute next instruction or subroutine call\n"
+                "    f      Continue until current subroutine returns\n"
                 "    c      Continue execution until breakpoint or HALT\n"
+                "    b      Set breakpoint at address or label, or list\n"
+                "           b ADDR [if CONDITION] [hit-count N]\n"
+                "    d      Remove breakpoint at address or label, or all\n"
+                "    w      Suspend when address or range is written, or list\n"
+                "    aw     Suspend when address or range is read or written\n"
+                "    uw     Remove watchpoint at address or range, or all\n"
+                "    rstep  Undo last instruction\n"
+                "    rcont  Undo instructions until breakpoint\n"
+                "    hist   Print addresses of most recent instructions\n"
                 "    mg     Print value at memory address\n"
                 "    ms     Set value at memory location\n"
                 /* "    rg     Print value of a register\n" */
@@ -385,9 +767,307 @@ DebuggerAction ask_debugger_command() {
     return DebuggerAction::NONE;
 }
 
+// Undo one instruction, or until a breakpoint is reached
+// Stops at start of undo log, as older instructions are forgotten
+void reverse_execution(const bool is_continue) {
+    size_t count = 0;
+    while (true) {
+        const Word next_pc = machine->registers.program_counter;
+        if (!undo_instruction())
+            break;
+        untrack_call(next_pc);
+        ++count;
+        if (!is_continue)
+            break;
+        const Word pc = machine->registers.program_counter;
+        if ((is_breakpoint_address(pc) && breakpoint_matches(pc, false)) ||
+            is_breakpoint_instruction(pc))
+            break;
+    }
+    if (count == 0 || (is_continue && undo_log.count == 0))
+        dprintfc("Reached start of undo log\n");
+    if (count > 0)
+        dprintfc("Reversed %zu instructions\n", count);
+    dprintfc("PC: 0x%04hx\n", machine->registers.program_counter);
+}
+
+// Set with `break`
+bool is_breakpoint_address(const Word addr) {
+    return (breakpoint_bits[addr / 64] >> (addr % 64) & 1) != 0;
+}
+
+// Called only if address bit is set
+// Hits are not counted when reversing
+bool breakpoint_matches(const Word addr, const bool count_hit) {
+    for (size_t i = 0; i < breakpoints.size(); ++i) {
+        Breakpoint &breakpoint = breakpoints[i];
+        if (breakpoint.addr != addr)
+            continue;
+        if (!breakpoint.condition.empty() &&
+            !evaluate_condition(breakpoint.condition))
+            return false;
+        if (!count_hit)
+            return true;
+        ++breakpoint.hits;
+        return breakpoint.hits >= breakpoint.hit_count;
+    }
+    return false;
+}
+
+// `ADDR [if CONDITION] [hit-count N]`, replacing any at the address
+void set_breakpoint(const char *&line) {
+    Breakpoint breakpoint;
+    if (!expect_address_or_label(line, breakpoint.addr))
+        return;
+    breakpoint.condition_text[0] = '\0';
+    breakpoint.hit_count = 0;
+    breakpoint.hits = 0;
+
+    if (take_keyword(line, "if")) {
+        take_whitespace(line);
+        const char *const start = line;
+        const char *const message =
+            compile_condition(line, breakpoint.condition);
+        if (message != nullptr) {
+            dprintfc("%s\n", message);
+            return;
+        }
+        size_t length = line - start;
+        while (length > 0 && isspace(start[length - 1]))
+            --length;
+        copy_string_slice_to_string(
+            breakpoint.condition_text, {start, length}
+        );
+    }
+    if (take_keyword(line, "hit-count")) {
+        if (!expect_count(line, breakpoint.hit_count))
+            return;
+    }
+    if (!is_end_of_command(line)) {
+        dprintfc("Unexpected argument\n");
+        return;
+    }
+
+    delete_breakpoint(breakpoint.addr);
+    breakpoints.push_back(breakpoint);
+    breakpoint_bits[breakpoint.addr / 64] |= 1UL << (breakpoint.addr % 64);
+    dprintfc("Set breakpoint at address 0x%04hx\n", breakpoint.addr);
+}
+
+void delete_breakpoint(const Word addr) {
+    for (size_t i = 0; i < breakpoints.size(); ++i) {
+        if (breakpoints[i].addr == addr) {
+            breakpoints.erase(breakpoints.begin() + i);
+            break;
+        }
+    }
+    breakpoint_bits[addr / 64] &= ~(1UL << (addr % 64));
+}
+
+void print_breakpoints() {
+    if (breakpoints.empty()) {
+        dprintfc("No breakpoints\n");
+        return;
+    }
+    for (size_t i = 0; i < breakpoints.size(); ++i) {
+        const Breakpoint &breakpoint = breakpoints[i];
+        dprintfc("    0x%04hx", breakpoint.addr);
+        const Symbol *const symbol = find_symbol_before(breakpoint.addr);
+        if (symbol != nullptr && symbol->address == breakpoint.addr)
+            dprintfc("  %s", symbol->name);
+        if (!breakpoint.condition.empty())
+            dprintfc("  if %s", breakpoint.condition_text);
+        if (breakpoint.hit_count > 0) {
+            dprintfc(
+                "  hit-count %lu",
+                static_cast<unsigned long>(breakpoint.hit_count)
+            );
+        }
+        dprintfc(
+            "  (%lu hits)\n", static_cast<unsigned long>(breakpoint.hits)
+        );
+    }
+}
+
+// Watch or unwatch all addresses from `start` to `end` (inclusive)
+void set_watchpoints(
+    const Word start, const Word end, const DebuggerCommand command
+) {
+    for (size_t addr = start; addr <= end; ++addr) {
+        const uint64_t bit = 1UL << (addr % 64);
+        if (command == DebuggerCommand::UNWATCH) {
+            watch_write_bits[addr / 64] &= ~bit;
+            watch_read_bits[addr / 64] &= ~bit;
+        } else {
+            watch_write_bits[addr / 64] |= bit;
+            if (command == DebuggerCommand::ACCESS_WATCH)
+                watch_read_bits[addr / 64] |= bit;
+        }
+    }
+
+    has_watchpoints = false;
+    for (size_t i = 0; i < MEMORY_SIZE / 64; ++i) {
+        if (watch_write_bits[i] != 0)
+            has_watchpoints = true;
+    }
+
+    const char *const action =
+        command == DebuggerCommand::UNWATCH ? "Removed" : "Set";
+    if (start == end)
+        dprintfc("%s watchpoint at address 0x%04hx\n", action, start)
+    else
+        dprintfc("%s watchpoints at 0x%04hx-0x%04hx\n", action, start, end)
+}
+
+// Ranges of addresses with the same kind of watchpoint
+void print_watchpoints() {
+    bool has_ranges = false;
+    size_t addr = 0;
+    while (addr < MEMORY_SIZE) {
+        const bool is_write = watch_write_bits[addr / 64] >> (addr % 64) & 1;
+        const bool is_read = watch_read_bits[addr / 64] >> (addr % 64) & 1;
+        size_t end = addr + 1;
+        while (end < MEMORY_SIZE &&
+               (watch_write_bits[end / 64] >> (end % 64) & 1) == is_write &&
+               (watch_read_bits[end / 64] >> (end % 64) & 1) == is_read)
+            ++end;
+        if (is_write) {
+            has_ranges = true;
+            dprintfc(
+                "    0x%04zx-0x%04zx  %s\n",
+                addr,
+                end - 1,
+                is_read ? "read/write" : "write"
+            );
+        }
+        addr = end;
+    }
+    if (!has_ranges)
+        dprintfc("No watchpoints\n");
+}
+
+// Called before `addr` is read (if `!is_write`) or written with `value`
+void check_watchpoint(
+    const Word addr, const Word value, const bool is_write
+) {
+    const uint64_t *const bits = is_write ? watch_write_bits : watch_read_bits;
+    if (!(bits[addr / 64] >> (addr % 64) & 1) || watch_hit.is_hit)
+        return;
+    watch_hit.is_hit = true;
+    watch_hit.is_write = is_write;
+    // PC was incremented on fetch
+    watch_hit.pc = static_cast<Word>(machine->registers.program_counter - 1);
+    watch_hit.addr = addr;
+    watch_hit.old = machine->memory[addr];
+    watch_hit.value = value;
+}
+
+// `true` if an access was reported
+bool report_watch_hit() {
+    if (!watch_hit.is_hit)
+        return false;
+    watch_hit.is_hit = false;
+    dprintf_style("\n");
+    if (watch_hit.is_write) {
+        dprintfc(
+            "Watchpoint: 0x%04hx written by instruction at 0x%04hx\n",
+            watch_hit.addr,
+            watch_hit.pc
+        );
+        dprintfc("    Old value: 0x%04hx\n", watch_hit.old);
+        dprintfc("    New value: 0x%04hx\n", watch_hit.value);
+    } else {
+        dprintfc(
+            "Watchpoint: 0x%04hx read by instruction at 0x%04hx\n",
+            watch_hit.addr,
+            watch_hit.pc
+        );
+        dprintfc("    Value: 0x%04hx\n", watch_hit.value);
+    }
+    return true;
+}
+
+// Called after `instr` at `pc` executed while debugging
+// A frame is popped once its return address is reached, as by `RET`
+void track_call(const Word pc, const Word instr) {
+    if (static_cast<Opcode>(instr >> 12) == Opcode::JSR_JSRR) {
+        if (call_stack.size() < MAX_DEBUGGER_CALL_DEPTH)
+            call_stack.push_back(static_cast<Word>(pc + 1));
+        return;
+    }
+    if (!call_stack.empty() &&
+        machine->registers.program_counter == call_stack.back())
+        call_stack.pop_back();
+}
+
+bool is_temporary_breakpoint_reached() {
+    return temporary_breakpoint.is_set &&
+           machine->registers.program_counter == temporary_breakpoint.addr &&
+           call_stack.size() <= temporary_breakpoint.depth;
+}
+
+// Whether each instruction must be checked while continuing
+// Otherwise the program runs at full speed, until a `DEBUG` trap or `HALT`
+bool is_continue_checked() {
+    return !breakpoints.empty() || has_watchpoints ||
+           temporary_breakpoint.is_set;
+}
+
+// Called while continuing unchecked, as `track_call` is not
+// A later `next` still works, as it only compares call depths
+void forget_call_stack() {
+    call_stack.clear();
+    is_call_stack_forgotten = true;
+}
+
+// Reverse of `track_call`, once the instruction before `next_pc` was undone
+// Only `RET` is assumed to have returned
+static void untrack_call(const Word next_pc) {
+    const Word pc = machine->registers.program_counter;
+    const Word instr = machine->memory[pc];
+    const Opcode opcode = static_cast<Opcode>(instr >> 12);
+    if (opcode == Opcode::JSR_JSRR) {
+        if (!call_stack.empty() && call_stack.back() == pc + 1)
+            call_stack.pop_back();
+    } else if (opcode == Opcode::JMP_RET && bits_6_8(instr) == 7) {
+        if (call_stack.size() < MAX_DEBUGGER_CALL_DEPTH)
+            call_stack.push_back(next_pc);
+    }
+}
+
+// Oldest first, including those before a snapshot or crash dump
+void print_pc_history() {
+    Word history[PC_HISTORY_SIZE];
+    const size_t count = get_pc_history(history);
+    if (count == 0) {
+        dprintfc("No instructions executed\n");
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        dprintfc("    0x%04hx", history[i]);
+        const Symbol *const symbol = find_symbol_before(history[i]);
+        if (symbol != nullptr) {
+            dprintfc(
+                "  %s+%hu",
+                symbol->name,
+                static_cast<Word>(history[i] - symbol->address)
+            );
+        }
+        dprintfc("\n");
+    }
+}
+
+// `DEBUG` trap
+bool is_breakpoint_instruction(const Word addr) {
+    const Word instr = machine->memory[addr];
+    return static_cast<Opcode>(instr >> 12) == Opcode::TRAP &&
+           (instr & 0xff) == static_cast<Word>(TrapVector::DEBUG);
+}
+
 void run_all_debugger_commands(
     bool &do_halt, bool &do_prompt, bool &do_debugger
 ) {
+    temporary_breakpoint.is_set = false;
     while (true) {
         switch (ask_debugger_command()) {
             case DebuggerAction::STEP:
@@ -403,6 +1083,10 @@ void run_all_debugger_commands(
 
             case DebuggerAction::STOP:
                 do_debugger = false;
+                // No longer needed
+                undo_log.is_enabled = false;
+                update_instrumented();
+                has_watchpoints = false;
                 return;
 
             case DebuggerAction::NONE:
@@ -432,8 +1116,8 @@ void print_registers(FILE *const file) {
     fprintf(
         file,
         "pc: 0x%04hx          cc: %c",
-        registers.program_counter,
-        condition_char(registers.condition)
+        machine->registers.program_counter,
+        condition_char(machine->registers.condition)
     );
     fprintf(file, " %s\n", box_v);
 
@@ -442,7 +1126,7 @@ void print_registers(FILE *const file) {
     fprintf(file, " %s\n", box_v);
 
     for (int reg = 0; reg < GP_REGISTER_COUNT; ++reg) {
-        const Word value = registers.general_purpose[reg];
+        const Word value = machine->registers.general_purpose[reg];
         fprintf(file, "  %s ", box_v);
         fprintf(file, "r%d  0x%04hx  %6hd  %5hu", reg, value, value, value);
         fprintf(file, " %s\n", box_v);
@@ -453,20 +1137,26 @@ void print_registers(FILE *const file) {
         fprintf(file, "%s", box_h);
     fprintf(file, "%s\n", box_br);
 
-    stdout_on_new_line = true;
+    machine->stdout_on_new_line = true;
 }
 
-char condition_char(ConditionCode condition) {
-    switch (condition) {
-        case ConditionCode::NEGATIVE:
-            return 'N';
-        case ConditionCode::ZERO:
-            return 'Z';
-        case ConditionCode::POSITIVE:
-            return 'P';
-        default:
-            return '?';
+// For scripts: `pc=0x3000 cc=Z r0=0x0000 ... r7=0x0000`
+void print_registers_line(FILE *const file) {
+    fprintf(
+        file,
+        "pc=0x%04hx cc=%c",
+        machine->registers.program_counter,
+        condition_char(machine->registers.condition)
+    );
+    for (int reg = 0; reg < GP_REGISTER_COUNT; ++reg) {
+        fprintf(
+            file, " r%d=0x%04hx", reg, machine->registers.general_purpose[reg]
+        );
     }
+    fprintf(file, "\n");
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
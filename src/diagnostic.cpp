@@ -0,0 +1,94 @@
+#ifndef DIAGNOSTIC_CPP
+#define DIAGNOSTIC_CPP
+
+#include <cstdarg>  // va_list, etc
+#include <cstdio>   // fprintf, vsnprintf, etc
+#include <vector>   // std::vector
+
+#include "slice.cpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+#define MAX_DIAGNOSTIC 256  // Includes '\0'
+
+// Assembler error message, collected instead of printed
+typedef struct Diagnostic {
+    int line_number;  // 0 if not specific to a line
+    char message[MAX_DIAGNOSTIC];
+} Diagnostic;
+
+// Message for the line currently being assembled
+// If `list` is `nullptr`, messages are printed directly to stderr instead
+//     (for example, when the tokenizer is used by the debugger)
+// Thread-local, so each thread can assemble its own source
+static thread_local struct {
+    vector<Diagnostic> *list = nullptr;
+    char message[MAX_DIAGNOSTIC];
+    size_t length = 0;
+} diagnostics;
+
+void diagnostic(const char *const format, ...);
+void diagnostic_string_slice(const StringSlice &slice);
+void push_diagnostic(const int line_number);
+void print_diagnostics(const vector<Diagnostic> &list);
+
+// Like `fprintf(stderr, ...)`, but appends to the pending message
+// Message is truncated if too long
+void diagnostic(const char *const format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (diagnostics.list == nullptr) {
+        vfprintf(stderr, format, args);
+    } else if (diagnostics.length < MAX_DIAGNOSTIC - 1) {
+        const size_t remaining = MAX_DIAGNOSTIC - diagnostics.length;
+        const int written = vsnprintf(
+            diagnostics.message + diagnostics.length, remaining, format, args
+        );
+        if (written > 0) {
+            diagnostics.length += static_cast<size_t>(written) < remaining
+                                      ? written
+                                      : remaining - 1;
+        }
+    }
+    va_end(args);
+}
+
+void diagnostic_string_slice(const StringSlice &slice) {
+    for (size_t i = 0; i < slice.length; ++i) {
+        diagnostic("%c", slice.pointer[i]);
+    }
+}
+
+// Move pending message to the list
+void push_diagnostic(const int line_number) {
+    if (diagnostics.list == nullptr)
+        return;
+    // Trailing newline is added when printed
+    if (diagnostics.length > 0 &&
+        diagnostics.message[diagnostics.length - 1] == '\n') {
+        --diagnostics.length;
+    }
+    diagnostics.list->push_back({});
+    Diagnostic &diag = diagnostics.list->back();
+    diag.line_number = line_number;
+    for (size_t i = 0; i < diagnostics.length; ++i)
+        diag.message[i] = diagnostics.message[i];
+    diag.message[diagnostics.length] = '\0';
+    diagnostics.length = 0;
+}
+
+void print_diagnostics(const vector<Diagnostic> &list) {
+    for (size_t i = 0; i < list.size(); ++i) {
+        fprintf(stderr, "%s\n", list[i].message);
+        if (list[i].line_number > 0)
+            fprintf(stderr, "\tLine %d\n", list[i].line_number);
+    }
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef ERROR_HPP
 #define ERROR_HPP
 
+namespace lasim {
+namespace internal {
+
 #define UNIMPLEMENTED()                               \
     {                                                 \
         fprintf(stderr, "Not yet implemented.\n");    \
@@ -24,13 +27,28 @@
 
 // Each variant correspnds to a process exit code
 enum class Error {
-    OK = 0x00,             // No error
-    CLI = 0x10,            // Parsing CLI arguments
-    FILE = 0x20,           // Opening/reading file
-    ASSEMBLE = 0x30,       // Parsing/assembling .asm
-    EXECUTE = 0x40,        // Executing .obj
-    UNIMPLEMENTED = 0x80,  // Feature not implemented
-    UNREACHABLE = 0xff,    // Unreachable code was reached
+    OK = 0x00,                  // No error
+    CLI = 0x10,                 // Parsing CLI arguments
+    FILE = 0x20,                // Opening/reading file
+    ASSEMBLE = 0x30,            // Parsing/assembling .asm
+    EXECUTE = 0x40,             // Executing .obj
+    LIMIT_INSTRUCTIONS = 0x41,  // Instruction limit reached before HALT
+    LIMIT_OUTPUT = 0x42,        // Output limit exceeded
+    LIMIT_TIME = 0x43,          // Wall-clock limit reached before HALT
+    INFINITE_LOOP = 0x44,       // Machine state repeated, so can never HALT
+    INTERRUPTED = 0x45,         // Stopped by signal, such as SIGINT
+    UNIMPLEMENTED = 0x80,       // Feature not implemented
+    UNREACHABLE = 0xff,         // Unreachable code was reached
 };
 
+// Program was stopped early, rather than failing itself
+inline bool is_limit_error(const Error error) {
+    return error == Error::LIMIT_INSTRUCTIONS ||
+           error == Error::LIMIT_OUTPUT || error == Error::LIMIT_TIME ||
+           error == Error::INFINITE_LOOP || error == Error::INTERRUPTED;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
 #endif
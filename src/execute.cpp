@@ -6,11 +6,19 @@
 
 #include "bitmasks.hpp"
 #include "debugger.cpp"
+#include "diagnostic.cpp"
 #include "error.hpp"
 #include "globals.hpp"
+#include "instrument.cpp"
+#include "loop.cpp"
+#include "machine.cpp"
+#include "snapshot.cpp"
 #include "tty.cpp"
 #include "types.hpp"
 
+namespace lasim {
+namespace internal {
+
 #define _to_sext_word(_value, _size) \
     (sign_extend(static_cast<SignedWord>(_value), (_size)))
 #define low_5_bits_sext(_instr) (_to_sext_word((_instr) & BITMASK_LOW_5, 5))
@@ -24,6 +32,12 @@
 // TODO(refactor): Re-order functions
 
 void execute(const ObjectFile &input, bool debugger, Error &error);
+void execute_limited_instruction(
+    bool &do_halt, bool &do_breakpoint, Error &error
+);
+void execute_limited_instructions(
+    bool &do_halt, bool &do_breakpoint, Error &error
+);
 void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error);
 void execute_trap_instruction(
     const Word instr, bool &do_halt, bool &do_breakpoint, Error &error
@@ -32,10 +46,14 @@ void execute_trap_instruction(
 void read_obj_filename_to_memory(const char *const obj_filename, Error &error);
 
 Word &memory_checked(Word addr, Error &error);
+Word memory_read_checked(Word addr, Error &error);
+void memory_write_checked(Word addr, const Word value, Error &error);
 
 SignedWord sign_extend(SignedWord value, const size_t size);
 void set_condition_codes(const SignedWord result);
+int read_char(void);
 void print_char(char ch);
+void print_string(const char *const string);
 void print_on_new_line(void);
 
 static char *halfbyte_string(const Word word);
@@ -50,8 +68,16 @@ void execute(const ObjectFile &input, bool debugger, Error &error) {
 
     // TODO(feat/debugger): Loop the whole program until debugger quit
 
-    // GP and condition registers are already initialized to 0
-    registers.program_counter = memory_file_bounds.start;
+    if (input.kind == ObjectFile::SNAPSHOT) {
+        load_snapshot(input.filename, error);
+        OK_OR_RETURN(error);
+        start_run();
+        resume_snapshot_input();
+    } else {
+        // GP and condition registers are already initialized to 0
+        machine->registers.program_counter = machine->memory_file_bounds.start;
+        start_run();
+    }
 
     // Loop until `true` is returned, indicating a HALT (TRAP 0x25)
     bool do_halt = false;
@@ -60,50 +86,175 @@ void execute(const ObjectFile &input, bool debugger, Error &error) {
         if (debugger) {
             if (do_debugger_prompt) {
                 // TODO(feat): Print value at PC with `print_integer_value`
-                dprintf("\n");
-                dprintfc("PC: 0x%04hx\n", registers.program_counter);
+                dprintf_style("\n");
+                dprintfc("PC: 0x%04hx\n", machine->registers.program_counter);
                 // TODO(refactor): Probably inline this (switch statement)
                 run_all_debugger_commands(
                     do_halt, do_debugger_prompt, debugger
                 );
+                // Registers or memory may have been modified
+                reset_loop_detector();
                 if (do_halt)
                     break;
-                dprintf("\x1b[2m");
-                dprintfc("···············\n");
+                dprintf_style("\x1b[2m");
+                dprintf_style(DEBUGGER_COLOR "···············\n\x1b[0m");
             }
         }
 
+        const Word pc = machine->registers.program_counter;
+        const Word instr = machine->memory[pc];
         bool do_breakpoint = false;
-        execute_next_instrution(do_halt, do_breakpoint, error);
+        // Unless stepping, or a breakpoint or watchpoint is set, continuing
+        //     runs like a normal run, without the checks below
+        const bool is_checked =
+            debugger && (do_debugger_prompt || is_continue_checked());
+        if (is_checked) {
+            execute_limited_instruction(do_halt, do_breakpoint, error);
+        } else {
+            if (debugger)
+                forget_call_stack();
+            execute_limited_instructions(do_halt, do_breakpoint, error);
+        }
         if (error != Error::OK) {
+            if (is_limit_error(error)) {
+                // Final state
+                print_registers(stderr);
+            }
+            if (error == Error::INTERRUPTED &&
+                snapshot.save_filename != nullptr)
+                save_snapshot(snapshot.save_filename, "snapshot", error);
+            if (!is_limit_error(error) && snapshot.crash_filename != nullptr)
+                save_crash_dump(snapshot.crash_filename);
             fprintf(stderr, "Execution failed.\n");
             return;
         }
 
+        // Stop here, so the snapshot resumes after the trap
+        if (do_breakpoint && snapshot.save_filename != nullptr) {
+            print_on_new_line();
+            save_snapshot(snapshot.save_filename, "snapshot", error);
+            return;
+        }
+
         if (do_breakpoint) {
             // Ignore if not debugging
             if (debugger) {
                 if (do_debugger_prompt) {
                     dprintfc("(Passing breakpoint trap)\n");
                 } else {
-                    dprintfc("\n");
+                    dprintf_style("\n");
                     dprintfc("Breakpoint encountered. Suspending execution.\n");
                     do_debugger_prompt = true;
                 }
             }
         }
+
+        if (is_checked)
+            track_call(pc, instr);
+
+        if (is_checked && report_watch_hit()) {
+            dprintfc("Suspending execution.\n");
+            do_debugger_prompt = true;
+        }
+
+        // Bitmap is only checked while continuing, so stepping and a normal
+        //     run are unaffected
+        if (is_checked && !do_debugger_prompt &&
+            is_breakpoint_address(machine->registers.program_counter) &&
+            breakpoint_matches(machine->registers.program_counter, true)) {
+            dprintf_style("\n");
+            dprintfc(
+                "Breakpoint at address 0x%04hx. Suspending execution.\n",
+                machine->registers.program_counter
+            );
+            do_debugger_prompt = true;
+        }
+
+        // Set by `next` or `finish`
+        if (is_checked && !do_debugger_prompt &&
+            is_temporary_breakpoint_reached())
+            do_debugger_prompt = true;
     }
 
     print_on_new_line();
 
-    if (debugger)
-        dprintfc("\nProgram completed\n")
+    // At `HALT`, so a resumed snapshot halts again
+    if (snapshot.save_filename != nullptr) {
+        --machine->registers.program_counter;
+        save_snapshot(snapshot.save_filename, "snapshot", error);
+    }
+
+    if (debugger) {
+        dprintf_style("\n");
+        dprintfc("Program completed\n");
+    }
+}
+
+// Execute and count next instruction, checking limits if due
+// Limits are checked only every `LIMIT_CHECK_INTERVAL` instructions (or
+//     sooner, for an instruction limit), so the common case is one comparison
+void execute_limited_instruction(
+    bool &do_halt, bool &do_breakpoint, Error &error
+) {
+    const Word pc = machine->registers.program_counter;
+    const Word instr = machine->memory[pc];
+    machine->pc_history[machine->instruction_count % PC_HISTORY_SIZE] = pc;
+    execute_next_instrution(do_halt, do_breakpoint, error);
+    ++machine->instruction_count;
+    if (is_instrumented && error == Error::OK)
+        observe_instruction(pc, instr);
+    if (do_halt || error != Error::OK)
+        return;
+    if (machine->instruction_count >= machine->next_limit_check)
+        check_limits(error);
+    if (machine->detect_loops && error == Error::OK)
+        check_loop(error);
+}
+
+// Execute instructions until `HALT`, a `DEBUG` trap, failure, or the next
+//     limit check (which is then done)
+// Unless instrumented or detecting loops (which need each instruction, like
+//     the debugger), the inner loop only counts down a local
+void execute_limited_instructions(
+    bool &do_halt, bool &do_breakpoint, Error &error
+) {
+    if (is_instrumented || machine->detect_loops) {
+        execute_limited_instruction(do_halt, do_breakpoint, error);
+        return;
+    }
+
+    Word *const history = machine->pc_history;
+    const Registers &registers = machine->registers;
+    uint64_t count = machine->instruction_count;
+    const uint64_t next_check = machine->next_limit_check;
+    // At least one instruction, like `execute_limited_instruction`
+    uint64_t remaining = next_check > count ? next_check - count : 1;
+
+    do {
+        // Indexed by the local count, so the history costs one store
+        history[count % PC_HISTORY_SIZE] = registers.program_counter;
+        execute_next_instrution(do_halt, do_breakpoint, error);
+        ++count;
+        --remaining;
+    } while (remaining > 0 && !do_halt && !do_breakpoint &&
+             error == Error::OK);
+
+    machine->instruction_count = count;
+    if (do_halt || error != Error::OK)
+        return;
+    if (count >= next_check)
+        check_limits(error);
 }
 
 // `true` return value indicates that program should end
 void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
+    Word *const memory = machine->memory;
+    Registers &registers = machine->registers;
+
     memory_checked(registers.program_counter, error);
     OK_OR_RETURN(error);
+    if (is_instrumented)
+        observe_memory(registers.program_counter, MemoryAccess::FETCH);
 
     const Word instr = memory[registers.program_counter];
     ++registers.program_counter;
@@ -126,9 +277,8 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
                 // 2 bits padding
                 const uint8_t padding = bits_3_4(instr);
                 if (padding != 0b00) {
-                    fprintf(
-                        stderr, "Expected padding 0b00 for ADD instruction\n"
-                    );
+                    diagnostic("Expected padding 0b00 for ADD instruction\n");
+                    push_diagnostic(0);
                     SET_ERROR(error, EXECUTE);
                     return;
                 }
@@ -159,9 +309,8 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
                 // 2 bits padding
                 const uint8_t padding = bits_3_4(instr);
                 if (padding != 0b00) {
-                    fprintf(
-                        stderr, "Expected padding 0b00 for AND instruction\n"
-                    );
+                    diagnostic("Expected padding 0b00 for AND instruction\n");
+                    push_diagnostic(0);
                     SET_ERROR(error, EXECUTE);
                     return;
                 }
@@ -184,9 +333,8 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             // 4 bits ONEs padding
             const uint8_t padding = bits_0_5(instr);
             if (padding != BITMASK_LOW_5) {
-                fprintf(
-                    stderr, "Expected padding 0x11111 for NOT instruction\n"
-                );
+                diagnostic("Expected padding 0x11111 for NOT instruction\n");
+                push_diagnostic(0);
                 SET_ERROR(error, EXECUTE);
                 return;
             }
@@ -204,9 +352,10 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
 
             const uint8_t condition = bits_9_11(instr);
             if (condition == 0b000) {
-                fprintf(
-                    stderr, "Invalid condition code 0b000 for BR* instruction\n"
+                diagnostic(
+                    "Invalid condition code 0b000 for BR* instruction\n"
                 );
+                push_diagnostic(0);
                 SET_ERROR(error, EXECUTE);
                 return;
             }
@@ -225,9 +374,8 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             // 3 bits padding
             const uint8_t padding_1 = bits_9_11(instr);
             if (padding_1 != 0b000) {
-                fprintf(
-                    stderr, "Expected padding 0b000 for JMP/RET instruction\n"
-                );
+                diagnostic("Expected padding 0b000 for JMP/RET instruction\n");
+                push_diagnostic(0);
                 SET_ERROR(error, EXECUTE);
                 return;
             }
@@ -235,10 +383,10 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             // After base register
             const uint8_t padding_2 = bits_0_6(instr);
             if (padding_2 != 0b000000) {
-                fprintf(
-                    stderr,
+                diagnostic(
                     "Expected padding 0b000000 for JMP/RET instruction\n"
                 );
+                push_diagnostic(0);
                 SET_ERROR(error, EXECUTE);
                 return;
             }
@@ -264,9 +412,8 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
                 // 2 bits padding
                 const uint8_t padding = bits_9_10(instr);
                 if (padding != 0b00) {
-                    fprintf(
-                        stderr, "Expected padding 0b00 for JSRR instruction\n"
-                    );
+                    diagnostic("Expected padding 0b00 for JSRR instruction\n");
+                    push_diagnostic(0);
                     SET_ERROR(error, EXECUTE);
                     return;
                 }
@@ -283,7 +430,7 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const SignedWord offset = low_9_bits_sext(instr);
 
             const Word value =
-                memory_checked(registers.program_counter + offset, error);
+                memory_read_checked(registers.program_counter + offset, error);
             OK_OR_RETURN(error);
             registers.general_purpose[dest_reg] = value;
             set_condition_codes(value);
@@ -295,7 +442,9 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const SignedWord offset = low_9_bits_sext(instr);
 
             const Word value = registers.general_purpose[src_reg];
-            memory_checked(registers.program_counter + offset, error) = value;
+            memory_write_checked(
+                registers.program_counter + offset, value, error
+            );
             OK_OR_RETURN(error);
         }; break;
 
@@ -306,7 +455,7 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const SignedWord offset = low_6_bits_sext(instr);
 
             const Word base = registers.general_purpose[base_reg];
-            const Word value = memory_checked(base + offset, error);
+            const Word value = memory_read_checked(base + offset, error);
             OK_OR_RETURN(error);
 
             registers.general_purpose[dest_reg] = value;
@@ -322,7 +471,7 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const Word base = registers.general_purpose[base_reg];
             const Word value = registers.general_purpose[src_reg];
 
-            memory_checked(base + offset, error) = value;
+            memory_write_checked(base + offset, value, error);
             OK_OR_RETURN(error);
         }; break;
 
@@ -332,9 +481,9 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const SignedWord offset = low_9_bits_sext(instr);
 
             const Word pointer =
-                memory_checked(registers.program_counter + offset, error);
+                memory_read_checked(registers.program_counter + offset, error);
             OK_OR_RETURN(error);
-            const Word value = memory_checked(pointer, error);
+            const Word value = memory_read_checked(pointer, error);
             OK_OR_RETURN(error);
 
             registers.general_purpose[dest_reg] = value;
@@ -347,11 +496,11 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
             const SignedWord offset = low_9_bits_sext(instr);
 
             const Word pointer =
-                memory_checked(registers.program_counter + offset, error);
+                memory_read_checked(registers.program_counter + offset, error);
             OK_OR_RETURN(error);
             const Word value = registers.general_purpose[src_reg];
 
-            memory_checked(pointer, error) = value;
+            memory_write_checked(pointer, value, error);
             OK_OR_RETURN(error);
         }; break;
 
@@ -373,23 +522,23 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
 
         // RTI (supervisor-only)
         case Opcode::RTI:
-            fprintf(
-                stderr,
+            diagnostic(
                 "Invalid use of RTI opcode: 0b%s in non-supervisor mode\n",
                 halfbyte_string(static_cast<Word>(opcode))
             );
+            push_diagnostic(0);
             SET_ERROR(error, EXECUTE);
             return;
             break;
 
         // Invalid enum variant
         default:
-            fprintf(
-                stderr,
+            diagnostic(
                 "Invalid opcode: 0b%s (0x%04x)\n",
                 halfbyte_string(static_cast<Word>(opcode)),
                 static_cast<Word>(opcode)
             );
+            push_diagnostic(0);
             SET_ERROR(error, EXECUTE);
             return;
     }
@@ -398,10 +547,13 @@ void execute_next_instrution(bool &do_halt, bool &do_breakpoint, Error &error) {
 void execute_trap_instruction(
     const Word instr, bool &do_halt, bool &do_breakpoint, Error &error
 ) {
+    Registers &registers = machine->registers;
+
     // 4 bits padding
     const uint8_t padding = bits_8_12(instr);
     if (padding != 0b0000) {
-        fprintf(stderr, "Expected padding 0x00 for TRAP instruction\n");
+        diagnostic("Expected padding 0x00 for TRAP instruction\n");
+        push_diagnostic(0);
         SET_ERROR(error, EXECUTE);
         return;
     }
@@ -412,18 +564,14 @@ void execute_trap_instruction(
 
     switch (trap_vector) {
         case TrapVector::GETC: {
-            tty_nobuffer_noecho();                         // Disable echo
-            const char input = getchar() & BITMASK_LOW_8;  // Zero high 8 bits
-            tty_restore();
+            const char input = read_char() & BITMASK_LOW_8;  // Zero high 8 bits
             registers.general_purpose[0] = input;
         }; break;
 
         case TrapVector::IN: {
             print_on_new_line();
-            printf(TRAP_IN_PROMPT);
-            tty_nobuffer_noecho();
-            const char input = getchar() & BITMASK_LOW_8;  // Zero high 8 bits
-            tty_restore();
+            print_string(TRAP_IN_PROMPT);
+            const char input = read_char() & BITMASK_LOW_8;  // Zero high 8 bits
             print_char(input);
             print_on_new_line();
             registers.general_purpose[0] = input;
@@ -439,7 +587,7 @@ void execute_trap_instruction(
 
         case TrapVector::PUTS: {
             for (Word i = registers.general_purpose[0];; ++i) {
-                const Word word = memory_checked(i, error);
+                const Word word = memory_read_checked(i, error);
                 OK_OR_RETURN(error);
 
                 if (word == 0x0000)
@@ -454,7 +602,7 @@ void execute_trap_instruction(
             // Loop over words, then split into bytes
             // This is done to ensure the memory check is sound
             for (Word i = registers.general_purpose[0];; ++i) {
-                const Word word = memory_checked(i, error);
+                const Word word = memory_read_checked(i, error);
                 OK_OR_RETURN(error);
 
                 const char high = static_cast<char>(bits_high(word));
@@ -474,7 +622,18 @@ void execute_trap_instruction(
             return;
 
         case TrapVector::REG:
-            print_registers(stdout);
+            if (machine->output == nullptr) {
+                print_registers(stdout);
+            } else {
+                // Send to output callback instead
+                char *buffer;
+                size_t size;
+                FILE *const file = open_memstream(&buffer, &size);
+                print_registers(file);
+                fclose(file);
+                print_string(buffer);
+                free(buffer);
+            }
             break;
 
         case TrapVector::DEBUG:
@@ -482,17 +641,22 @@ void execute_trap_instruction(
             return;
 
         default:
-            fprintf(
-                stderr,
+            diagnostic(
                 "Invalid trap vector 0x%02x\n",
                 static_cast<Word>(trap_vector)
             );
+            push_diagnostic(0);
             SET_ERROR(error, EXECUTE);
             return;
     }
+
+    // Now, rather than at the next limit check, which may be much later
+    if (error == Error::OK)
+        check_output_limit(error);
 }
 
 void read_obj_filename_to_memory(const char *const obj_filename, Error &error) {
+    Word *const memory = machine->memory;
     size_t words_read;
 
     FILE *obj_file;
@@ -555,23 +719,53 @@ void read_obj_filename_to_memory(const char *const obj_filename, Error &error) {
     for (size_t i = end; i < MEMORY_SIZE; ++i)
         memory[i] = 0;
 
-    memory_file_bounds.start = start;
-    memory_file_bounds.end = end;
+    machine->memory_file_bounds.start = start;
+    machine->memory_file_bounds.end = end;
+    for (size_t i = 0; i < TOUCHED_PAGE_COUNT / 64; ++i)
+        machine->touched_pages[i] = 0;
+    touch_memory_range(start, end);
 
     fclose(obj_file);
 }
 
 // Check memory address is within the 'allocated' file memory
 Word &memory_checked(Word addr, Error &error) {
-    if (addr < memory_file_bounds.start) {
-        fprintf(stderr, "Cannot access non-user memory (before user memory)\n");
+    if (addr < machine->memory_file_bounds.start) {
+        diagnostic("Cannot access non-user memory (before user memory)\n");
+        push_diagnostic(0);
         SET_ERROR(error, EXECUTE);
     }
     if (addr > MEMORY_USER_MAX) {
-        fprintf(stderr, "Cannot access non-user memory (after user memory)\n");
+        diagnostic("Cannot access non-user memory (after user memory)\n");
+        push_diagnostic(0);
         SET_ERROR(error, EXECUTE);
     }
-    return memory[addr];
+    return machine->memory[addr];
+}
+
+// Like `memory_checked`, but also observed by instrumentation and watchpoints
+Word memory_read_checked(Word addr, Error &error) {
+    const Word word = memory_checked(addr, error);
+    if (is_instrumented && error == Error::OK)
+        observe_memory(addr, MemoryAccess::READ);
+    if (has_watchpoints && error == Error::OK)
+        check_watchpoint(addr, word, false);
+    return word;
+}
+
+// Like `memory_checked`, but also tracks write for loop detection,
+//     instrumentation, and watchpoints
+void memory_write_checked(Word addr, const Word value, Error &error) {
+    Word &word = memory_checked(addr, error);
+    OK_OR_RETURN(error);
+    if (is_instrumented)
+        observe_memory(addr, MemoryAccess::WRITE);
+    if (has_watchpoints)
+        check_watchpoint(addr, value, true);
+    if (machine->detect_loops)
+        loop_detector_write(addr, word, value);
+    touch_memory(addr);
+    word = value;
 }
 
 // TODO(fix): Truncate to `size` bits in this function, don't rely on caller
@@ -586,31 +780,66 @@ SignedWord sign_extend(SignedWord value, const size_t size) {
 
 void set_condition_codes(const SignedWord result) {
     if (result < 0) {
-        registers.condition = ConditionCode::NEGATIVE;
+        machine->registers.condition = ConditionCode::NEGATIVE;
     } else if (result == 0) {
-        registers.condition = ConditionCode::ZERO;
+        machine->registers.condition = ConditionCode::ZERO;
+    } else {
+        machine->registers.condition = ConditionCode::POSITIVE;
+    }
+}
+
+// Read without echo, from input callback if set
+int read_char() {
+    // Following state depends on input, so previous states cannot recur
+    if (machine->detect_loops)
+        reset_loop_detector();
+    int ch;
+    if (machine->input != nullptr) {
+        ch = machine->input(machine->io_context);
     } else {
-        registers.condition = ConditionCode::POSITIVE;
+        if (snapshot.input_to_skip > 0)
+            skip_snapshot_input();
+        tty_nobuffer_noecho();  // Disable echo
+        ch = getchar();
+        tty_restore();
     }
+    if (ch != EOF)
+        ++machine->input_count;
+    return ch;
 }
 
+// Print to output callback if set
+// Output past the output limit is discarded
 void print_char(char ch) {
+    ++machine->output_count;
+    if (machine->limits.max_output > 0 &&
+        machine->output_count > machine->limits.max_output) {
+        // Failure is reported by `check_output_limit`
+        return;
+    }
+
     if (ch == '\r')
         ch = '\n';
-    printf("%c", ch);
-    stdout_on_new_line = ch == '\n';
+    if (machine->output != nullptr)
+        machine->output(ch, machine->io_context);
+    else
+        printf("%c", ch);
+    machine->stdout_on_new_line = ch == '\n';
+}
+
+void print_string(const char *const string) {
+    for (size_t i = 0; string[i] != '\0'; ++i)
+        print_char(string[i]);
 }
 
 void print_on_new_line() {
-    if (!stdout_on_new_line) {
-        printf("\n");
-        stdout_on_new_line = true;
-    }
+    if (!machine->stdout_on_new_line)
+        print_char('\n');
 }
 
 // Since %b printf format specifier is ""not ISO-compliant""
 static char *halfbyte_string(const Word word) {
-    static char str[5];
+    static thread_local char str[5];
     for (int i = 0; i < 4; ++i) {
         str[i] = '0' + ((word >> (3 - i)) & 0b1);
     }
@@ -618,4 +847,7 @@ static char *halfbyte_string(const Word word) {
     return str;
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
@@ -0,0 +1,84 @@
+#ifndef FEEDBACK_CPP
+#define FEEDBACK_CPP
+
+#include <vector>  // std::vector
+
+#include "globals.hpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Entries of edge map, indexed by a hash of branch address and target
+#define FEEDBACK_MAP_SIZE 65536
+
+// What a fuzzing run did, to score its input and to undo it
+// Only touched entries are cleared, so a short run is cheap to reset
+typedef struct Feedback {
+    bool is_enabled = false;
+    // Hits of each edge in this run, saturating at 255
+    vector<uint8_t> edge_hits;
+    // Indexes of non-zero `edge_hits`
+    vector<Word> hit_edges;
+    // Addresses written in this run, and a flag per address
+    vector<Word> written;
+    vector<uint8_t> is_written;
+} Feedback;
+
+static Feedback feedback;
+
+void enable_feedback(void);
+void feedback_instruction(const Word pc, const Word instr);
+void feedback_access(const Word addr, const MemoryAccess access);
+// Restores written memory from `original`, and clears edges
+void reset_feedback(const Word *const original);
+
+void enable_feedback() {
+    feedback.is_enabled = true;
+    feedback.edge_hits.assign(FEEDBACK_MAP_SIZE, 0);
+    feedback.hit_edges.clear();
+    feedback.written.clear();
+    feedback.is_written.assign(MEMORY_SIZE, 0);
+}
+
+// Edge from a control-flow instruction to the next PC, taken or not
+// Address is rotated, so an edge and its reverse have different entries
+void feedback_instruction(const Word pc, const Word instr) {
+    const Opcode opcode = static_cast<Opcode>(instr >> 12);
+    if (opcode != Opcode::BR && opcode != Opcode::JMP_RET &&
+        opcode != Opcode::JSR_JSRR)
+        return;
+    const Word next = machine->registers.program_counter;
+    const Word index = static_cast<Word>(pc << 7 | pc >> 9) ^ next;
+    uint8_t &hits = feedback.edge_hits[index];
+    if (hits == 0)
+        feedback.hit_edges.push_back(index);
+    if (hits < 255)
+        ++hits;
+}
+
+void feedback_access(const Word addr, const MemoryAccess access) {
+    if (access != MemoryAccess::WRITE || feedback.is_written[addr])
+        return;
+    feedback.is_written[addr] = 1;
+    feedback.written.push_back(addr);
+}
+
+void reset_feedback(const Word *const original) {
+    for (size_t i = 0; i < feedback.written.size(); ++i) {
+        const Word addr = feedback.written[i];
+        machine->memory[addr] = original[addr];
+        feedback.is_written[addr] = 0;
+    }
+    feedback.written.clear();
+    for (size_t i = 0; i < feedback.hit_edges.size(); ++i)
+        feedback.edge_hits[feedback.hit_edges[i]] = 0;
+    feedback.hit_edges.clear();
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
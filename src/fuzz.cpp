@@ -0,0 +1,461 @@
+#ifndef FUZZ_CPP
+#define FUZZ_CPP
+
+#include <dirent.h>    // opendir, readdir
+#include <fcntl.h>     // open
+#include <sys/stat.h>  // mkdir
+#include <unistd.h>    // close, dup, dup2
+
+#include <cerrno>   // errno
+#include <csignal>  // signal, SIGINT, SIGTERM
+#include <cstdio>   // printf, fopen, fread, fwrite
+#include <cstring>  // strncmp
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "execute.cpp"
+#include "feedback.cpp"
+#include "globals.hpp"
+#include "instrument.cpp"
+#include "machine.cpp"
+#include "snapshot.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Coverage-guided fuzzing of program input
+//
+// Each run gives an input to `GETC` and `IN`, then restores the memory it
+//     wrote and the registers, so the object is only loaded once.
+// An input is kept in the corpus if it hits a new edge, or an edge a new
+//     amount of times (in buckets, like AFL). New inputs are mutations of
+//     corpus inputs.
+// An input which fails is saved as `crash-*`, and one which reaches a limit
+//     (such as the instruction budget) as `hang-*`, once per failing PC.
+
+#define FUZZ_MAX_INPUT 256
+#define FUZZ_MAX_STACKED_MUTATIONS 8
+// If not set by `--max-instructions`
+#define FUZZ_DEFAULT_MAX_INSTRUCTIONS 100000
+#define FUZZ_STATUS_INTERVAL_NANOSECONDS 1000000000
+
+// Likely to reach new paths in programs reading characters
+static const uint8_t FUZZ_INTERESTING_BYTES[] = {
+    0x00, '\n', ' ', '+', '-', '0', '1', '9', 'A', 'Z', 'a', 'z', 0x7f, 0xff,
+};
+
+typedef struct Fuzzer {
+    const char *corpus_dirname;
+    vector<vector<uint8_t>> corpus;
+    // Memory after loading the object
+    vector<Word> original;
+
+    // Hit buckets seen for each edge, over all runs
+    vector<uint8_t> seen_buckets;  // `FEEDBACK_MAP_SIZE`
+    size_t edge_count;
+    // Saved failures, as error kind and PC
+    vector<uint32_t> failures;
+
+    // Input of current run
+    const vector<uint8_t> *input;
+    size_t input_offset;
+
+    uint64_t run_count;
+    uint64_t crash_count;
+    uint64_t hang_count;
+    bool has_write_failed;
+    uint64_t random_state;
+} Fuzzer;
+
+// Runs until interrupted, or until `max_runs` if not 0
+// `error` is set if any input crashed or hanged
+void run_fuzzer(
+    const char *const obj_filename,
+    const char *const corpus_dirname,
+    const uint64_t max_runs,
+    Error &error
+);
+
+static void load_fuzz_corpus(Fuzzer &fuzzer, Error &error);
+static void fuzz_input(
+    Fuzzer &fuzzer, const vector<uint8_t> &input, const bool is_seed
+);
+static Error run_fuzz_input(Fuzzer &fuzzer, const vector<uint8_t> &input);
+static bool has_new_fuzz_edges(Fuzzer &fuzzer);
+static void save_fuzz_failure(
+    Fuzzer &fuzzer, const vector<uint8_t> &input, const Error result
+);
+// `path` is `FILENAME_MAX` bytes
+static void save_fuzz_input(
+    Fuzzer &fuzzer,
+    const char *const prefix,
+    const vector<uint8_t> &input,
+    char *const path
+);
+static void mutate_fuzz_input(Fuzzer &fuzzer, vector<uint8_t> &input);
+static void print_fuzz_status(const Fuzzer &fuzzer, const char *const label);
+static int read_fuzz_char(void *context);
+static void discard_fuzz_char(char ch, void *context);
+static uint64_t next_fuzz_random(Fuzzer &fuzzer);
+
+void run_fuzzer(
+    const char *const obj_filename,
+    const char *const corpus_dirname,
+    const uint64_t max_runs,
+    Error &error
+) {
+    read_obj_filename_to_memory(obj_filename, error);
+    OK_OR_RETURN(error);
+
+    Fuzzer fuzzer;
+    fuzzer.corpus_dirname = corpus_dirname;
+    fuzzer.original.assign(machine->memory, machine->memory + MEMORY_SIZE);
+    fuzzer.seen_buckets.assign(FEEDBACK_MAP_SIZE, 0);
+    fuzzer.edge_count = 0;
+    fuzzer.run_count = 0;
+    fuzzer.crash_count = 0;
+    fuzzer.hang_count = 0;
+    fuzzer.has_write_failed = false;
+    fuzzer.random_state = monotonic_nanoseconds() | 1;
+    load_fuzz_corpus(fuzzer, error);
+    OK_OR_RETURN(error);
+
+    if (machine->limits.max_instructions == 0)
+        machine->limits.max_instructions = FUZZ_DEFAULT_MAX_INSTRUCTIONS;
+    machine->input = read_fuzz_char;
+    machine->output = discard_fuzz_char;
+    machine->io_context = &fuzzer;
+    enable_feedback();
+    update_instrumented();
+    signal(SIGINT, request_interrupt);
+    signal(SIGTERM, request_interrupt);
+
+    // Failing runs print messages, which would be far too many
+    fflush(stderr);
+    const int stderr_fd = dup(STDERR_FILENO);
+    const int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDERR_FILENO);
+        close(null_fd);
+    }
+
+    // Seeds are run as they are, so existing coverage is not saved again
+    const size_t seed_count = fuzzer.corpus.size();
+    for (size_t i = 0; i < seed_count && !interrupt_requested; ++i)
+        fuzz_input(fuzzer, fuzzer.corpus[i], true);
+    print_fuzz_status(fuzzer, "seeds");
+
+    uint64_t next_status =
+        monotonic_nanoseconds() + FUZZ_STATUS_INTERVAL_NANOSECONDS;
+    vector<uint8_t> input;
+    while (!interrupt_requested &&
+           (max_runs == 0 || fuzzer.run_count < max_runs)) {
+        const size_t index = next_fuzz_random(fuzzer) % fuzzer.corpus.size();
+        input = fuzzer.corpus[index];
+        mutate_fuzz_input(fuzzer, input);
+        fuzz_input(fuzzer, input, false);
+        // Clock is read rarely, as runs are short
+        if (fuzzer.run_count % 1024 == 0 &&
+            monotonic_nanoseconds() >= next_status) {
+            print_fuzz_status(fuzzer, "running");
+            next_status += FUZZ_STATUS_INTERVAL_NANOSECONDS;
+        }
+    }
+
+    if (stderr_fd >= 0) {
+        dup2(stderr_fd, STDERR_FILENO);
+        close(stderr_fd);
+    }
+    print_fuzz_status(fuzzer, "done");
+    if (fuzzer.has_write_failed) {
+        fprintf(stderr, "Failed to write to corpus directory\n");
+        SET_ERROR(error, FILE);
+    }
+    if (fuzzer.crash_count > 0 || fuzzer.hang_count > 0)
+        SET_ERROR(error, EXECUTE);
+}
+
+// Directory is created if it does not exist
+// An empty corpus is given one empty input
+static void load_fuzz_corpus(Fuzzer &fuzzer, Error &error) {
+    if (mkdir(fuzzer.corpus_dirname, 0755) != 0 && errno != EEXIST) {
+        fprintf(
+            stderr,
+            "Could not create corpus directory: %s\n",
+            fuzzer.corpus_dirname
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+    DIR *const dir = opendir(fuzzer.corpus_dirname);
+    if (dir == nullptr) {
+        fprintf(
+            stderr,
+            "Could not open corpus directory: %s\n",
+            fuzzer.corpus_dirname
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    // Failures are not seeds, as they would fail again
+    // Directory and entry name may each be nearly `FILENAME_MAX`
+    char path[FILENAME_MAX * 2];
+    const dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char *const name = entry->d_name;
+        if (name[0] == '.' || !strncmp(name, "crash-", 6) ||
+            !strncmp(name, "hang-", 5))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", fuzzer.corpus_dirname, name);
+        FILE *const file = fopen(path, "rb");
+        if (file == nullptr)
+            continue;
+        uint8_t bytes[FUZZ_MAX_INPUT];
+        const size_t length = fread(bytes, 1, FUZZ_MAX_INPUT, file);
+        fclose(file);
+        fuzzer.corpus.push_back(vector<uint8_t>(bytes, bytes + length));
+    }
+    closedir(dir);
+
+    if (fuzzer.corpus.empty())
+        fuzzer.corpus.push_back({});
+}
+
+// Keeps input if it is interesting, or saves it if it failed
+static void fuzz_input(
+    Fuzzer &fuzzer, const vector<uint8_t> &input, const bool is_seed
+) {
+    const Error result = run_fuzz_input(fuzzer, input);
+    ++fuzzer.run_count;
+    if (result == Error::INTERRUPTED)
+        return;
+    if (result != Error::OK) {
+        save_fuzz_failure(fuzzer, input, result);
+        return;
+    }
+    if (has_new_fuzz_edges(fuzzer) && !is_seed) {
+        fuzzer.corpus.push_back(input);
+        char path[FILENAME_MAX];
+        save_fuzz_input(fuzzer, "id", input, path);
+    }
+}
+
+// Machine is reset from the last run, rather than loaded again
+static Error run_fuzz_input(Fuzzer &fuzzer, const vector<uint8_t> &input) {
+    reset_feedback(fuzzer.original.data());
+    Registers &registers = machine->registers;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        registers.general_purpose[i] = 0;
+    registers.program_counter = machine->memory_file_bounds.start;
+    registers.condition = CONDITION_DEFAULT;
+    fuzzer.input = &input;
+    fuzzer.input_offset = 0;
+    start_run();
+
+    Error error = Error::OK;
+    bool do_halt = false;
+    while (!do_halt && error == Error::OK) {
+        // `DEBUG` trap is ignored
+        bool do_breakpoint = false;
+        execute_limited_instructions(do_halt, do_breakpoint, error);
+    }
+    return error;
+}
+
+// Bucket of hit count is a single bit, so buckets seen are a mask
+static bool has_new_fuzz_edges(Fuzzer &fuzzer) {
+    bool has_new = false;
+    for (size_t i = 0; i < feedback.hit_edges.size(); ++i) {
+        const Word index = feedback.hit_edges[i];
+        const uint8_t hits = feedback.edge_hits[index];
+        uint8_t bucket;
+        if (hits <= 3)
+            bucket = 1 << (hits - 1);  // 1, 2, 3
+        else if (hits < 8)
+            bucket = 1 << 3;
+        else if (hits < 16)
+            bucket = 1 << 4;
+        else if (hits < 32)
+            bucket = 1 << 5;
+        else if (hits < 128)
+            bucket = 1 << 6;
+        else
+            bucket = 1 << 7;
+
+        uint8_t &seen = fuzzer.seen_buckets[index];
+        if (bucket & ~seen) {
+            if (seen == 0)
+                ++fuzzer.edge_count;
+            seen |= bucket;
+            has_new = true;
+        }
+    }
+    return has_new;
+}
+
+// Once per kind of failure and PC, as most failing inputs are similar
+static void save_fuzz_failure(
+    Fuzzer &fuzzer, const vector<uint8_t> &input, const Error result
+) {
+    Word pcs[PC_HISTORY_SIZE];
+    const size_t history_count = get_pc_history(pcs);
+    const Word pc = history_count > 0 ? pcs[history_count - 1] : 0;
+    const bool is_hang = is_limit_error(result);
+    const uint32_t failure = static_cast<uint32_t>(is_hang) << 16 | pc;
+    for (size_t i = 0; i < fuzzer.failures.size(); ++i) {
+        if (fuzzer.failures[i] == failure)
+            return;
+    }
+    fuzzer.failures.push_back(failure);
+
+    if (is_hang)
+        ++fuzzer.hang_count;
+    else
+        ++fuzzer.crash_count;
+    printf(
+        "%s at 0x%04hx after %lu instructions\n",
+        is_hang ? "Hang" : "Crash",
+        pc,
+        static_cast<unsigned long>(machine->instruction_count)
+    );
+    char path[FILENAME_MAX];
+    save_fuzz_input(fuzzer, is_hang ? "hang" : "crash", input, path);
+    printf("    Saved input: %s\n", path);
+}
+
+// Named by FNV-1a hash of input, so equal inputs have the same file
+static void save_fuzz_input(
+    Fuzzer &fuzzer,
+    const char *const prefix,
+    const vector<uint8_t> &input,
+    char *const path
+) {
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i < input.size(); ++i)
+        hash = (hash ^ input[i]) * 16777619;
+
+    snprintf(
+        path,
+        FILENAME_MAX,
+        "%s/%s-%08x",
+        fuzzer.corpus_dirname,
+        prefix,
+        static_cast<unsigned>(hash)
+    );
+    FILE *const file = fopen(path, "wb");
+    if (file == nullptr) {
+        fuzzer.has_write_failed = true;
+        return;
+    }
+    if (fwrite(input.data(), 1, input.size(), file) != input.size())
+        fuzzer.has_write_failed = true;
+    if (fclose(file) != 0)
+        fuzzer.has_write_failed = true;
+}
+
+// Applies several random mutations
+// Deletion and crossover can shorten input, so runs stay short
+static void mutate_fuzz_input(Fuzzer &fuzzer, vector<uint8_t> &input) {
+    const size_t count =
+        1 + next_fuzz_random(fuzzer) % FUZZ_MAX_STACKED_MUTATIONS;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t random = next_fuzz_random(fuzzer);
+        size_t kind = random % 8;
+        const uint8_t byte = static_cast<uint8_t>(random >> 8);
+        const uint8_t interesting = FUZZ_INTERESTING_BYTES
+            [(random >> 16) % sizeof(FUZZ_INTERESTING_BYTES)];
+        const size_t position = (random >> 32) % (input.size() + 1);
+
+        // Others need a byte to change
+        if (input.empty() && kind < 5)
+            kind = 5 + kind % 2;
+        if (kind >= 5 && kind <= 6 && input.size() >= FUZZ_MAX_INPUT)
+            kind = 4;
+
+        switch (kind) {
+            case 0:
+                input[position % input.size()] ^= 1 << (byte & 7);
+                break;
+            case 1:
+                input[position % input.size()] = byte;
+                break;
+            case 2:
+                input[position % input.size()] = interesting;
+                break;
+            case 3:
+                // Small change, such as to a neighbouring digit
+                input[position % input.size()] += (byte & 7) - 3;
+                break;
+            case 4: {
+                const size_t start = position % input.size();
+                size_t length = 1 + byte % 8;
+                if (length > input.size() - start)
+                    length = input.size() - start;
+                input.erase(
+                    input.begin() + start, input.begin() + start + length
+                );
+            }; break;
+            case 5:
+                input.insert(input.begin() + position, byte);
+                break;
+            case 6:
+                input.insert(input.begin() + position, interesting);
+                break;
+            case 7: {
+                // Start of this input, then rest of another
+                const vector<uint8_t> &other =
+                    fuzzer.corpus[(random >> 48) % fuzzer.corpus.size()];
+                input.resize(position);
+                if (position < other.size()) {
+                    input.insert(
+                        input.end(), other.begin() + position, other.end()
+                    );
+                }
+            }; break;
+        }
+    }
+}
+
+static void print_fuzz_status(const Fuzzer &fuzzer, const char *const label) {
+    printf(
+        "%-8s runs %lu, corpus %zu, edges %zu, crashes %lu, hangs %lu\n",
+        label,
+        static_cast<unsigned long>(fuzzer.run_count),
+        fuzzer.corpus.size(),
+        fuzzer.edge_count,
+        static_cast<unsigned long>(fuzzer.crash_count),
+        static_cast<unsigned long>(fuzzer.hang_count)
+    );
+    fflush(stdout);
+}
+
+// Input ends like a closed stdin
+static int read_fuzz_char(void *context) {
+    Fuzzer &fuzzer = *static_cast<Fuzzer *>(context);
+    if (fuzzer.input_offset >= fuzzer.input->size())
+        return EOF;
+    return (*fuzzer.input)[fuzzer.input_offset++];
+}
+
+static void discard_fuzz_char(char ch, void *context) {
+    (void)ch;
+    (void)context;
+}
+
+// xorshift64*
+static uint64_t next_fuzz_random(Fuzzer &fuzzer) {
+    uint64_t &state = fuzzer.random_state;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -1,20 +1,106 @@
 #ifndef GLOBALS_HPP
 #define GLOBALS_HPP
 
+#include <csignal>  // sig_atomic_t
 #include <cstdlib>  // exit
+#include <vector>   // std::vector
 
 #include "types.hpp"
 
-static Word memory[MEMORY_SIZE];
+namespace lasim {
+namespace internal {
 
-static Registers registers;
+// Most recent PCs kept by every run, such as for crash dumps
+// Power of 2, so indexing by instruction count is a mask
+#define PC_HISTORY_SIZE 64
 
-// Start and end addresses of file in memory
-static struct {
-    Word start;
-    Word end;
-} memory_file_bounds;
+// Pages of memory which were loaded or written, so a snapshot stores only
+//     those, as all other memory is 0
+#define TOUCHED_PAGE_SIZE 256  // Words
+#define TOUCHED_PAGE_COUNT (MEMORY_SIZE / TOUCHED_PAGE_SIZE)
 
-static bool stdout_on_new_line = true;  // Count start of stream as new line
+// Returns a character, or `EOF` if input has ended
+typedef int (*InputCallback)(void *context);
+typedef void (*OutputCallback)(char ch, void *context);
+
+// Value of an address before it was first written
+typedef struct WrittenWord {
+    Word addr;
+    Word old;
+} WrittenWord;
+
+// State of infinite-loop detection, see `loop.cpp`
+typedef struct LoopDetector {
+    bool has_checkpoint = false;
+    // Checkpoint state
+    Registers registers;
+    uint64_t checkpoint_hash = 0;
+    // Of all writes since start of run
+    uint64_t memory_hash = 0;
+    // Addresses written since checkpoint, and their value at checkpoint
+    std::vector<WrittenWord> written;
+    uint64_t written_bits[MEMORY_SIZE / 64] = {0};
+    // Instructions since checkpoint, and at which to take next checkpoint
+    uint64_t length = 0;
+    uint64_t power = 1;
+    // Range of PC since checkpoint
+    Word min_pc = 0;
+    Word max_pc = 0;
+} LoopDetector;
+
+// All state of a simulated LC-3 machine
+typedef struct Machine {
+    Word memory[MEMORY_SIZE];
+
+    Registers registers;
+
+    // Bit per page of `TOUCHED_PAGE_SIZE` words, set by `touch_memory`
+    uint64_t touched_pages[TOUCHED_PAGE_COUNT / 64] = {0};
+
+    // Start and end addresses of file in memory
+    struct {
+        Word start;
+        Word end;
+    } memory_file_bounds;
+
+    bool stdout_on_new_line = true;  // Count start of stream as new line
+
+    // Used by traps instead of stdin/stdout, if not `nullptr`
+    InputCallback input = nullptr;
+    OutputCallback output = nullptr;
+    void *io_context = nullptr;
+
+    Limits limits = {0, 0, 0};
+    // Counted from start of run
+    uint64_t instruction_count = 0;
+    uint64_t output_count = 0;
+    uint64_t input_count = 0;
+    uint64_t start_nanoseconds = 0;
+    // Limits are only checked when `instruction_count` reaches this
+    uint64_t next_limit_check = 0;
+    // Limits are checked regularly for `interrupt_requested`
+    bool check_interrupts = false;
+
+    // PC of each instruction, at `instruction_count` modulo size
+    Word pc_history[PC_HISTORY_SIZE];
+    // Entries from before this run, as restored from a snapshot
+    size_t pc_history_resumed = 0;
+
+    bool detect_loops = false;
+    LoopDetector loop_detector;
+} Machine;
+
+static Machine default_machine;
+
+// Set by a signal handler, and checked with limits
+static volatile sig_atomic_t interrupt_requested = 0;
+
+// Machine which is read and modified by all executor functions
+// Thread-local, so each thread can run its own machine
+// Must not be `nullptr`
+static thread_local Machine *machine = &default_machine;
+
+}  // namespace internal
+}  // namespace lasim
 
 #endif
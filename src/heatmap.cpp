@@ -0,0 +1,245 @@
+#ifndef HEATMAP_CPP
+#define HEATMAP_CPP
+
+#include <cmath>    // log
+#include <cstdio>   // fprintf, fopen
+#include <cstring>  // strlen, strcmp
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "profile.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Instructions per working-set sample
+#define HEATMAP_WINDOW 1024
+// Samples are merged to fit this many rows in the report
+#define HEATMAP_MAX_ROWS 16
+#define HEATMAP_HOTTEST_COUNT 10
+// PGM image has one pixel per address
+#define HEATMAP_IMAGE_WIDTH 256
+
+// Data reads and writes per address, not including instruction fetches
+typedef struct Heatmap {
+    bool is_enabled = false;
+    // Opened when enabled, so errors are reported early
+    FILE *file;
+    bool is_image;  // PGM if `true`, otherwise CSV
+
+    // `MEMORY_SIZE` once enabled
+    vector<uint64_t> read_counts;
+    vector<uint64_t> write_counts;
+    // Window each address was last accessed in, or 0 if never
+    vector<uint32_t> last_windows;
+
+    uint64_t distinct_count;
+    // Current window, starting at 1
+    uint32_t window;
+    uint64_t window_instructions;
+    uint32_t window_distinct_count;
+    // Distinct addresses accessed in each completed window
+    vector<uint32_t> working_sets;
+} Heatmap;
+
+static Heatmap heatmap;
+
+void enable_heatmap(const char *const filename, Error &error);
+void heatmap_access(const Word addr, const MemoryAccess access);
+void heatmap_instruction(void);
+void print_heatmap(FILE *const file);
+
+static void print_heatmap_working_sets(FILE *const file);
+static void print_heatmap_hottest(
+    FILE *const file, const char *const title, const uint64_t *const counts
+);
+static void write_heatmap_csv(FILE *const file);
+static void write_heatmap_pgm(FILE *const file);
+
+// Filename ending in `.pgm` writes an image, otherwise CSV
+void enable_heatmap(const char *const filename, Error &error) {
+    heatmap.file = fopen(filename, "wb");
+    if (heatmap.file == nullptr) {
+        fprintf(
+            stderr, "Failed to open heatmap file for writing: %s\n", filename
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+    const size_t length = strlen(filename);
+    heatmap.is_image = length >= 4 && !strcmp(filename + length - 4, ".pgm");
+
+    heatmap.is_enabled = true;
+    heatmap.read_counts.assign(MEMORY_SIZE, 0);
+    heatmap.write_counts.assign(MEMORY_SIZE, 0);
+    heatmap.last_windows.assign(MEMORY_SIZE, 0);
+    heatmap.distinct_count = 0;
+    heatmap.window = 1;
+    heatmap.window_instructions = 0;
+    heatmap.window_distinct_count = 0;
+    heatmap.working_sets.clear();
+}
+
+void heatmap_access(const Word addr, const MemoryAccess access) {
+    if (access == MemoryAccess::FETCH)
+        return;
+    if (access == MemoryAccess::READ)
+        ++heatmap.read_counts[addr];
+    else
+        ++heatmap.write_counts[addr];
+
+    uint32_t &last_window = heatmap.last_windows[addr];
+    if (last_window != heatmap.window) {
+        if (last_window == 0)
+            ++heatmap.distinct_count;
+        last_window = heatmap.window;
+        ++heatmap.window_distinct_count;
+    }
+}
+
+void heatmap_instruction() {
+    ++heatmap.window_instructions;
+    if (heatmap.window_instructions < HEATMAP_WINDOW)
+        return;
+    heatmap.working_sets.push_back(heatmap.window_distinct_count);
+    heatmap.window_distinct_count = 0;
+    heatmap.window_instructions = 0;
+    ++heatmap.window;
+}
+
+// Report, and write heatmap file
+void print_heatmap(FILE *const file) {
+    // Include partial last window
+    if (heatmap.window_instructions > 0)
+        heatmap.working_sets.push_back(heatmap.window_distinct_count);
+
+    uint64_t total_reads = 0;
+    uint64_t total_writes = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        total_reads += heatmap.read_counts[i];
+        total_writes += heatmap.write_counts[i];
+    }
+    fprintf(
+        file,
+        "\nMemory accesses: %lu reads, %lu writes, %lu distinct addresses\n",
+        static_cast<unsigned long>(total_reads),
+        static_cast<unsigned long>(total_writes),
+        static_cast<unsigned long>(heatmap.distinct_count)
+    );
+    print_heatmap_working_sets(file);
+    print_heatmap_hottest(file, "reads", heatmap.read_counts.data());
+    print_heatmap_hottest(file, "writes", heatmap.write_counts.data());
+
+    if (heatmap.is_image)
+        write_heatmap_pgm(heatmap.file);
+    else
+        write_heatmap_csv(heatmap.file);
+    fclose(heatmap.file);
+}
+
+// Largest working set of each group of windows
+static void print_heatmap_working_sets(FILE *const file) {
+    const vector<uint32_t> &sets = heatmap.working_sets;
+    if (sets.empty())
+        return;
+    const size_t group =
+        (sets.size() + HEATMAP_MAX_ROWS - 1) / HEATMAP_MAX_ROWS;
+
+    fprintf(
+        file,
+        "\nWorking set (distinct addresses per %d instructions):\n",
+        HEATMAP_WINDOW
+    );
+    fprintf(file, "  FROM INSTRUCTION  WORKING SET\n");
+    for (size_t start = 0; start < sets.size(); start += group) {
+        uint32_t largest = 0;
+        for (size_t i = start; i < start + group && i < sets.size(); ++i) {
+            if (sets[i] > largest)
+                largest = sets[i];
+        }
+        fprintf(
+            file,
+            "  %16lu  %11u\n",
+            static_cast<unsigned long>(start * HEATMAP_WINDOW),
+            largest
+        );
+    }
+}
+
+static void print_heatmap_hottest(
+    FILE *const file, const char *const title, const uint64_t *const counts
+) {
+    Word hottest[HEATMAP_HOTTEST_COUNT];
+    const size_t hottest_count =
+        find_hottest_addresses(counts, hottest, HEATMAP_HOTTEST_COUNT);
+    if (hottest_count == 0)
+        return;
+
+    fprintf(file, "\nMost %s:\n", title);
+    fprintf(file, "      COUNT  ADDRESS  LINE  LABEL\n");
+    for (size_t i = 0; i < hottest_count; ++i) {
+        fprintf(
+            file,
+            "%11lu   0x%04hx",
+            static_cast<unsigned long>(counts[hottest[i]]),
+            hottest[i]
+        );
+        print_address_location(file, hottest[i]);
+        fprintf(file, "\n");
+    }
+}
+
+// Only addresses which were accessed
+static void write_heatmap_csv(FILE *const file) {
+    fprintf(file, "address,reads,writes\n");
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        const uint64_t reads = heatmap.read_counts[i];
+        const uint64_t writes = heatmap.write_counts[i];
+        if (reads == 0 && writes == 0)
+            continue;
+        fprintf(
+            file,
+            "0x%04zx,%lu,%lu\n",
+            i,
+            static_cast<unsigned long>(reads),
+            static_cast<unsigned long>(writes)
+        );
+    }
+}
+
+// Greyscale, with each row being 256 consecutive addresses
+// Brightness is logarithmic in total accesses, and any access is visible
+static void write_heatmap_pgm(FILE *const file) {
+    uint64_t largest = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        const uint64_t total = heatmap.read_counts[i] + heatmap.write_counts[i];
+        if (total > largest)
+            largest = total;
+    }
+
+    fprintf(
+        file,
+        "P5\n%d %ld\n255\n",
+        HEATMAP_IMAGE_WIDTH,
+        MEMORY_SIZE / HEATMAP_IMAGE_WIDTH
+    );
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        const uint64_t total = heatmap.read_counts[i] + heatmap.write_counts[i];
+        uint8_t pixel = 0;
+        if (total > 0 && largest <= 1) {
+            pixel = 255;
+        } else if (total > 0) {
+            const double scale = log(total) / log(largest);
+            pixel = static_cast<uint8_t>(1 + 254 * scale);
+        }
+        fputc(pixel, file);
+    }
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
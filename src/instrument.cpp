@@ -0,0 +1,109 @@
+#ifndef INSTRUMENT_CPP
+#define INSTRUMENT_CPP
+
+#include <cstdio>  // stderr
+
+#include "bpred.cpp"
+#include "cache.cpp"
+#include "callgraph.cpp"
+#include "coverage.cpp"
+#include "feedback.cpp"
+#include "heatmap.cpp"
+#include "pipeline.cpp"
+#include "profile.cpp"
+#include "reverse.cpp"
+#include "trace.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+// Analysis tools which observe each executed instruction and memory access
+// Only checked if `is_instrumented`, so a normal run pays a single branch
+// Only used by the CLI, so not thread-local
+static bool is_instrumented = false;
+// PC of instruction being executed, as of its fetch
+static Word instrumented_pc = 0;
+
+void update_instrumented(void);
+void observe_instruction(const Word pc, const Word instr);
+void observe_memory(const Word addr, const MemoryAccess access);
+void print_instrument_reports(void);
+
+// Should be called after enabling any tool
+void update_instrumented() {
+    is_instrumented = profile.is_enabled || callgraph.is_enabled ||
+                      heatmap.is_enabled || instruction_cache.is_enabled ||
+                      data_cache.is_enabled || branch_predictor.is_enabled ||
+                      pipeline.is_enabled || trace.is_enabled ||
+                      coverage.is_enabled || feedback.is_enabled ||
+                      undo_log.is_enabled;
+}
+
+// Called after `instr` at `pc` executed successfully
+void observe_instruction(const Word pc, const Word instr) {
+    if (profile.is_enabled)
+        profile_instruction(pc, instr);
+    if (callgraph.is_enabled)
+        callgraph_instruction(pc, instr);
+    if (heatmap.is_enabled)
+        heatmap_instruction();
+    if (branch_predictor.is_enabled)
+        branch_predictor_instruction(pc, instr);
+    if (pipeline.is_enabled)
+        pipeline_instruction(pc, instr);
+    if (trace.is_enabled)
+        trace_instruction(pc, instr);
+    if (coverage.is_enabled)
+        coverage_instruction(pc);
+    if (feedback.is_enabled)
+        feedback_instruction(pc, instr);
+}
+
+// Called before `addr` is accessed, after it is checked
+void observe_memory(const Word addr, const MemoryAccess access) {
+    if (access == MemoryAccess::FETCH) {
+        instrumented_pc = addr;
+        if (instruction_cache.is_enabled)
+            cache_access(instruction_cache, addr, addr, false);
+    } else if (data_cache.is_enabled) {
+        const bool is_write = access == MemoryAccess::WRITE;
+        cache_access(data_cache, instrumented_pc, addr, is_write);
+    }
+    if (heatmap.is_enabled)
+        heatmap_access(addr, access);
+    if (pipeline.is_enabled)
+        pipeline_access(access);
+    if (trace.is_enabled)
+        trace_access(addr, access);
+    if (undo_log.is_enabled)
+        undo_log_access(addr, access);
+    if (feedback.is_enabled)
+        feedback_access(addr, access);
+}
+
+void print_instrument_reports() {
+    if (profile.is_enabled)
+        print_profile(stderr);
+    if (callgraph.is_enabled)
+        print_callgraph(stderr);
+    if (heatmap.is_enabled)
+        print_heatmap(stderr);
+    if (instruction_cache.is_enabled)
+        print_cache(stderr, instruction_cache);
+    if (data_cache.is_enabled)
+        print_cache(stderr, data_cache);
+    if (branch_predictor.is_enabled)
+        print_branch_predictor(stderr);
+    if (pipeline.is_enabled)
+        print_pipeline(stderr);
+    if (trace.is_enabled)
+        print_trace(stderr);
+    if (coverage.is_enabled)
+        print_coverage(stderr);
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,223 @@
+// Implementation of `liblasim.a`
+// Built from the engine only (assembler and executor), without the command
+//     line tool, job server, fuzzer, or trace queries
+// Internals are in `lasim::internal`, so their names (such as `machine` or
+//     `Diagnostic`) cannot clash with those of a program linking the library
+
+#include "lasim.hpp"
+
+#include <new>  // std::nothrow
+
+#include "assemble.cpp"
+#include "diagnostic.cpp"
+#include "execute.cpp"
+#include "machine.cpp"
+
+namespace lasim {
+
+// Used by the interface below
+// `Machine` is not, as the interface has its own
+using internal::Assembly;
+using internal::Diagnostic;
+using internal::Error;
+using internal::Word;
+using internal::assemble_buffer;
+using internal::condition_char;
+using internal::diagnostic;
+using internal::diagnostics;
+using internal::execute_limited_instruction;
+using internal::load_words_to_memory;
+using internal::push_diagnostic;
+using internal::reset_machine;
+using internal::start_run;
+using std::vector;
+
+struct Machine {
+    internal::Machine state;
+    vector<Diagnostic> diagnostics;
+    bool is_loaded;
+    bool is_halted;
+};
+
+// All executor functions operate on the global `machine`
+static void select_machine(Machine *const handle) {
+    internal::machine = &handle->state;
+}
+
+// Assumes `handle` is selected
+static void after_load(Machine *const handle) {
+    handle->state.registers.program_counter =
+        handle->state.memory_file_bounds.start;
+    start_run();
+    handle->is_halted = false;
+}
+
+Machine *create_machine() {
+    Machine *const handle = new (std::nothrow) Machine();
+    if (handle == nullptr)
+        return nullptr;
+    reset_machine(handle->state);
+    handle->is_loaded = false;
+    handle->is_halted = false;
+    return handle;
+}
+
+void destroy_machine(Machine *const handle) {
+    if (handle == nullptr)
+        return;
+    if (internal::machine == &handle->state)
+        internal::machine = &internal::default_machine;
+    delete handle;
+}
+
+bool load_object(Machine *const handle, const uint8_t *bytes, size_t length) {
+    select_machine(handle);
+    handle->is_loaded = false;
+    handle->diagnostics.clear();
+
+    // Collect messages of `load_words_to_memory` instead of printing them
+    vector<Diagnostic> *const previous_list = diagnostics.list;
+    diagnostics.list = &handle->diagnostics;
+    Error error = Error::OK;
+    if (length % WORD_SIZE != 0) {
+        diagnostic("Object has an odd amount of bytes\n");
+        push_diagnostic(0);
+        SET_ERROR(error, EXECUTE);
+    } else {
+        vector<Word> words;
+        words.reserve(length / WORD_SIZE);
+        for (size_t i = 0; i + 1 < length; i += WORD_SIZE)
+            words.push_back(static_cast<Word>(bytes[i] << 8 | bytes[i + 1]));
+        reset_machine(handle->state);
+        load_words_to_memory(words.data(), words.size(), error);
+    }
+    diagnostics.list = previous_list;
+    if (error != Error::OK)
+        return false;
+
+    after_load(handle);
+    handle->is_loaded = true;
+    return true;
+}
+
+bool load_source(Machine *const handle, const char *source, size_t length) {
+    select_machine(handle);
+    handle->is_loaded = false;
+
+    Assembly assembly;
+    Error error = Error::OK;
+    assemble_buffer(source, length, assembly, error);
+    handle->diagnostics.swap(assembly.diagnostics);
+    if (error != Error::OK)
+        return false;
+
+    reset_machine(handle->state);
+    vector<Diagnostic> *const previous_list = diagnostics.list;
+    diagnostics.list = &handle->diagnostics;
+    load_words_to_memory(assembly.words.data(), assembly.words.size(), error);
+    diagnostics.list = previous_list;
+    if (error != Error::OK)
+        return false;
+
+    after_load(handle);
+    handle->is_loaded = true;
+    return true;
+}
+
+size_t diagnostic_count(const Machine *const handle) {
+    return handle->diagnostics.size();
+}
+
+const char *diagnostic_message(const Machine *const handle, size_t index) {
+    return handle->diagnostics[index].message;
+}
+
+int diagnostic_line(const Machine *const handle, size_t index) {
+    return handle->diagnostics[index].line_number;
+}
+
+void set_io(
+    Machine *const handle,
+    InputCallback input,
+    OutputCallback output,
+    void *context
+) {
+    handle->state.input = input;
+    handle->state.output = output;
+    handle->state.io_context = context;
+}
+
+Status step(Machine *const handle) {
+    if (!handle->is_loaded)
+        return Status::FAILED;
+    if (handle->is_halted)
+        return Status::HALTED;
+    select_machine(handle);
+
+    bool do_halt = false;
+    bool do_breakpoint = false;
+    Error error = Error::OK;
+    // Collect failure message instead of printing it
+    vector<Diagnostic> *const previous_list = diagnostics.list;
+    diagnostics.list = &handle->diagnostics;
+    execute_limited_instruction(do_halt, do_breakpoint, error);
+    diagnostics.list = previous_list;
+
+    if (error != Error::OK) {
+        handle->is_loaded = false;
+        return Status::FAILED;
+    }
+    if (do_halt) {
+        handle->is_halted = true;
+        return Status::HALTED;
+    }
+    if (do_breakpoint)
+        return Status::BREAKPOINT;
+    return Status::RUNNING;
+}
+
+Status run(Machine *const handle, uint64_t max_instructions) {
+    for (uint64_t i = 0; i < max_instructions; ++i) {
+        const Status status = step(handle);
+        if (status != Status::RUNNING)
+            return status;
+    }
+    return Status::RUNNING;
+}
+
+uint64_t instruction_count(const Machine *const handle) {
+    return handle->state.instruction_count;
+}
+
+uint16_t read_register(const Machine *const handle, int index) {
+    return handle->state.registers.general_purpose[index & BITMASK_LOW_3];
+}
+
+void write_register(Machine *const handle, int index, uint16_t value) {
+    handle->state.registers.general_purpose[index & BITMASK_LOW_3] = value;
+}
+
+uint16_t read_pc(const Machine *const handle) {
+    return handle->state.registers.program_counter;
+}
+
+void write_pc(Machine *const handle, uint16_t value) {
+    handle->state.registers.program_counter = value;
+}
+
+char read_condition(const Machine *const handle) {
+    return condition_char(handle->state.registers.condition);
+}
+
+uint16_t read_memory(const Machine *const handle, uint16_t address) {
+    return handle->state.memory[address];
+}
+
+void write_memory(Machine *const handle, uint16_t address, uint16_t value) {
+    handle->state.memory[address] = value;
+    // Like `touch_memory`, for a machine which may not be current
+    const size_t page = address / TOUCHED_PAGE_SIZE;
+    handle->state.touched_pages[page / 64] |= 1UL << (page % 64);
+}
+
+}  // namespace lasim
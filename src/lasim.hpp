@@ -0,0 +1,71 @@
+#ifndef LASIM_HPP
+#define LASIM_HPP
+
+// Public interface of `liblasim.a`
+// Programs linking the library should only include this file
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lasim {
+
+// Simulated LC-3 machine
+// Any amount of machines may exist, but they must be used from one thread
+struct Machine;
+
+// Why `step` or `run` returned
+enum class Status {
+    RUNNING,     // Instruction budget was used up, program can continue
+    HALTED,      // `HALT` trap was executed
+    BREAKPOINT,  // `DEBUG` trap was executed, program can continue
+    FAILED,      // Invalid instruction or memory access, or nothing loaded
+};
+
+// Returns a character, or -1 if input has ended
+typedef int (*InputCallback)(void *context);
+typedef void (*OutputCallback)(char ch, void *context);
+
+// Returns `nullptr` if memory could not be allocated
+Machine *create_machine(void);
+void destroy_machine(Machine *machine);
+
+// Object format is the same as an .obj file: big-endian words, origin first
+// Returns `false` if object has an odd amount of bytes, or is too short or
+//     too long for memory, see `diagnostic_*`
+bool load_object(Machine *machine, const uint8_t *bytes, size_t length);
+// Returns `false` if source failed to assemble, see `diagnostic_*`
+bool load_source(Machine *machine, const char *source, size_t length);
+
+// Diagnostics from the last call to `load_object` or `load_source`, followed
+//     by why execution failed, if `step` or `run` returned `FAILED`
+size_t diagnostic_count(const Machine *machine);
+const char *diagnostic_message(const Machine *machine, size_t index);
+int diagnostic_line(const Machine *machine, size_t index);  // 0 if none
+
+// Characters are read from stdin and written to stdout if callback is null
+void set_io(
+    Machine *machine,
+    InputCallback input,
+    OutputCallback output,
+    void *context
+);
+
+Status step(Machine *machine);
+Status run(Machine *machine, uint64_t max_instructions);
+// Total executed since last load
+uint64_t instruction_count(const Machine *machine);
+
+// `index` is 0-7 for R0-R7
+uint16_t read_register(const Machine *machine, int index);
+void write_register(Machine *machine, int index, uint16_t value);
+uint16_t read_pc(const Machine *machine);
+void write_pc(Machine *machine, uint16_t value);
+// 'N', 'Z', or 'P'
+char read_condition(const Machine *machine);
+
+uint16_t read_memory(const Machine *machine, uint16_t address);
+void write_memory(Machine *machine, uint16_t address, uint16_t value);
+
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef LOOP_CPP
+#define LOOP_CPP
+
+#include "diagnostic.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+// Infinite-loop detection, using Brent's cycle-finding algorithm
+//
+// Execution is deterministic between inputs, so if the machine state (PC,
+//     registers, condition, memory) ever recurs, the program can never halt.
+// A checkpoint of the state is taken after 1, 2, 4, 8, ... instructions, and
+//     each following state is compared against it. A loop is found within
+//     roughly twice the instructions of the loop start plus its length.
+//
+// Memory is not copied for a checkpoint. Instead, each first write to an
+//     address since the checkpoint records the old value, and an additive
+//     hash of all writes is kept. The state is only compared in full if the
+//     PC, registers, and memory hash all match the checkpoint.
+
+void reset_loop_detector(void);
+void loop_detector_write(const Word addr, const Word old, const Word value);
+void check_loop(Error &error);
+
+static void take_loop_checkpoint(LoopDetector &detector);
+static bool is_loop_checkpoint_state(const LoopDetector &detector);
+static uint64_t hash_memory_word(const Word addr, const Word value);
+
+// State before this point is forgotten, such as when input was read
+void reset_loop_detector() {
+    machine->loop_detector.has_checkpoint = false;
+}
+
+// Called before `value` is written over `old` at `addr`
+void loop_detector_write(const Word addr, const Word old, const Word value) {
+    LoopDetector &detector = machine->loop_detector;
+    detector.memory_hash +=
+        hash_memory_word(addr, value) - hash_memory_word(addr, old);
+
+    uint64_t &bits = detector.written_bits[addr / 64];
+    const uint64_t bit = 1UL << (addr % 64);
+    if (!(bits & bit)) {
+        bits |= bit;
+        detector.written.push_back({addr, old});
+    }
+}
+
+// Called after each instruction
+void check_loop(Error &error) {
+    LoopDetector &detector = machine->loop_detector;
+    if (!detector.has_checkpoint) {
+        detector.power = 1;
+        take_loop_checkpoint(detector);
+        return;
+    }
+
+    if (is_loop_checkpoint_state(detector)) {
+        diagnostic(
+            "Infinite loop detected: state repeats every %lu instructions\n"
+            "\tBetween PC 0x%04hx and 0x%04hx\n",
+            static_cast<unsigned long>(detector.length + 1),
+            detector.min_pc,
+            detector.max_pc
+        );
+        push_diagnostic(0);
+        SET_ERROR(error, INFINITE_LOOP);
+        return;
+    }
+
+    const Word pc = machine->registers.program_counter;
+    if (pc < detector.min_pc)
+        detector.min_pc = pc;
+    if (pc > detector.max_pc)
+        detector.max_pc = pc;
+
+    ++detector.length;
+    if (detector.length >= detector.power) {
+        detector.power *= 2;
+        take_loop_checkpoint(detector);
+    }
+}
+
+static void take_loop_checkpoint(LoopDetector &detector) {
+    detector.has_checkpoint = true;
+    detector.registers = machine->registers;
+    detector.checkpoint_hash = detector.memory_hash;
+    detector.length = 0;
+    detector.min_pc = machine->registers.program_counter;
+    detector.max_pc = machine->registers.program_counter;
+
+    // Only clear bits which were set
+    for (size_t i = 0; i < detector.written.size(); ++i)
+        detector.written_bits[detector.written[i].addr / 64] = 0;
+    detector.written.clear();
+}
+
+static bool is_loop_checkpoint_state(const LoopDetector &detector) {
+    const Registers &registers = machine->registers;
+    const Registers &checkpoint = detector.registers;
+
+    // Cheapest comparisons first
+    if (registers.program_counter != checkpoint.program_counter)
+        return false;
+    if (detector.memory_hash != detector.checkpoint_hash)
+        return false;
+    if (registers.condition != checkpoint.condition)
+        return false;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i) {
+        if (registers.general_purpose[i] != checkpoint.general_purpose[i])
+            return false;
+    }
+
+    // Hash may collide, so compare every written address
+    for (size_t i = 0; i < detector.written.size(); ++i) {
+        const WrittenWord &written = detector.written[i];
+        if (machine->memory[written.addr] != written.old)
+            return false;
+    }
+    return true;
+}
+
+// SplitMix64 finalizer
+static uint64_t hash_memory_word(const Word addr, const Word value) {
+    uint64_t hash = static_cast<uint64_t>(addr) << 16 | value;
+    hash += 0x9e3779b97f4a7c15;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    return hash ^ (hash >> 31);
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
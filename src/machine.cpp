@@ -0,0 +1,216 @@
+#ifndef MACHINE_CPP
+#define MACHINE_CPP
+
+#include <time.h>  // clock_gettime
+
+#include <cstdint>  // UINT64_MAX
+#include <cstdio>   // fprintf
+
+#include "diagnostic.cpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "loop.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+// Amount of instructions between reading the clock, for time limit
+#define LIMIT_CHECK_INTERVAL 4096
+
+void reset_machine(Machine &target);
+void touch_memory(const Word addr);
+void touch_memory_range(const size_t start, const size_t end);
+void load_words_to_memory(const Word *const words, size_t count, Error &error);
+
+void start_run(void);
+void check_limits(Error &error);
+void check_output_limit(Error &error);
+void schedule_limit_check(void);
+uint64_t monotonic_nanoseconds(void);
+size_t get_pc_history(Word *const pcs);
+char condition_char(ConditionCode condition);
+
+// Clear memory and registers, keeping I/O callbacks and limits
+void reset_machine(Machine &target) {
+    for (size_t i = 0; i < MEMORY_SIZE; ++i)
+        target.memory[i] = 0;
+    for (size_t i = 0; i < TOUCHED_PAGE_COUNT / 64; ++i)
+        target.touched_pages[i] = 0;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        target.registers.general_purpose[i] = 0;
+    target.registers.program_counter = 0;
+    target.registers.condition = CONDITION_DEFAULT;
+    target.memory_file_bounds.start = 0;
+    target.memory_file_bounds.end = 0;
+    target.stdout_on_new_line = true;
+    target.pc_history_resumed = 0;
+}
+
+// Must be called for every write to `machine->memory`, other than restoring
+//     an address which was already written
+// A single store, so it is cheap enough for every write by the program
+void touch_memory(const Word addr) {
+    const size_t page = addr / TOUCHED_PAGE_SIZE;
+    machine->touched_pages[page / 64] |= 1UL << (page % 64);
+}
+
+// From `start` to `end` (exclusive)
+void touch_memory_range(const size_t start, const size_t end) {
+    for (size_t addr = start; addr < end; addr += TOUCHED_PAGE_SIZE)
+        touch_memory(static_cast<Word>(addr));
+    if (end > start)
+        touch_memory(static_cast<Word>(end - 1));
+}
+
+// `words[0]` is origin, following words are placed in memory from origin
+// All other memory is cleared
+// Failure is a diagnostic, so it is collected if a list is set
+void load_words_to_memory(const Word *const words, size_t count, Error &error) {
+    if (count < 2) {
+        diagnostic("Object is too short\n");
+        push_diagnostic(0);
+        SET_ERROR(error, EXECUTE);
+        return;
+    }
+    const Word origin = words[0];
+    if (origin + count - 1 > MEMORY_SIZE) {
+        diagnostic("Object is too long\n");
+        push_diagnostic(0);
+        SET_ERROR(error, EXECUTE);
+        return;
+    }
+
+    Word *const memory = machine->memory;
+    const size_t end = origin + count - 1;
+    for (size_t i = 0; i < origin; ++i)
+        memory[i] = 0;
+    for (size_t i = origin; i < end; ++i)
+        memory[i] = words[i - origin + 1];
+    for (size_t i = end; i < MEMORY_SIZE; ++i)
+        memory[i] = 0;
+
+    machine->memory_file_bounds.start = origin;
+    machine->memory_file_bounds.end = end;
+    for (size_t i = 0; i < TOUCHED_PAGE_COUNT / 64; ++i)
+        machine->touched_pages[i] = 0;
+    touch_memory_range(origin, end);
+}
+
+// Reset counters for `machine->limits`, and loop detection
+void start_run() {
+    machine->instruction_count = 0;
+    machine->output_count = 0;
+    machine->input_count = 0;
+    machine->start_nanoseconds = monotonic_nanoseconds();
+    schedule_limit_check();
+    reset_loop_detector();
+}
+
+// Should be called when `instruction_count` reaches `next_limit_check`
+void check_limits(Error &error) {
+    const Limits &limits = machine->limits;
+
+    if (interrupt_requested) {
+        diagnostic("Interrupted\n");
+        push_diagnostic(0);
+        SET_ERROR(error, INTERRUPTED);
+        return;
+    }
+
+    check_output_limit(error);
+    OK_OR_RETURN(error);
+
+    if (limits.max_instructions > 0 &&
+        machine->instruction_count >= limits.max_instructions) {
+        diagnostic(
+            "Instruction limit of %lu reached\n",
+            static_cast<unsigned long>(limits.max_instructions)
+        );
+        push_diagnostic(0);
+        SET_ERROR(error, LIMIT_INSTRUCTIONS);
+        return;
+    }
+
+    if (limits.max_milliseconds > 0) {
+        const uint64_t elapsed =
+            monotonic_nanoseconds() - machine->start_nanoseconds;
+        if (elapsed / 1000000 >= limits.max_milliseconds) {
+            diagnostic(
+                "Time limit of %lu milliseconds reached\n",
+                static_cast<unsigned long>(limits.max_milliseconds)
+            );
+            push_diagnostic(0);
+            SET_ERROR(error, LIMIT_TIME);
+            return;
+        }
+    }
+
+    schedule_limit_check();
+}
+
+// Called after each output trap
+void check_output_limit(Error &error) {
+    const Limits &limits = machine->limits;
+    if (limits.max_output > 0 && machine->output_count > limits.max_output) {
+        diagnostic(
+            "Output limit of %lu bytes exceeded\n",
+            static_cast<unsigned long>(limits.max_output)
+        );
+        push_diagnostic(0);
+        SET_ERROR(error, LIMIT_OUTPUT);
+    }
+}
+
+void schedule_limit_check() {
+    const Limits &limits = machine->limits;
+    // Output limit is checked immediately by `check_output_limit`
+    if (limits.max_instructions == 0 && limits.max_milliseconds == 0 &&
+        !machine->check_interrupts) {
+        machine->next_limit_check = UINT64_MAX;
+        return;
+    }
+    uint64_t next = machine->instruction_count + LIMIT_CHECK_INTERVAL;
+    if (limits.max_instructions > 0 && next > limits.max_instructions)
+        next = limits.max_instructions;
+    machine->next_limit_check = next;
+}
+
+// Copies up to `PC_HISTORY_SIZE` most recent PCs to `pcs`, oldest first
+// Returns amount copied
+size_t get_pc_history(Word *const pcs) {
+    uint64_t length = machine->instruction_count + machine->pc_history_resumed;
+    if (length > PC_HISTORY_SIZE)
+        length = PC_HISTORY_SIZE;
+    // Resumed entries end before index 0
+    const uint64_t end = machine->instruction_count + PC_HISTORY_SIZE;
+    for (size_t i = 0; i < length; ++i) {
+        const size_t index = (end - length + i) % PC_HISTORY_SIZE;
+        pcs[i] = machine->pc_history[index];
+    }
+    return length;
+}
+
+char condition_char(ConditionCode condition) {
+    switch (condition) {
+        case ConditionCode::NEGATIVE:
+            return 'N';
+        case ConditionCode::ZERO:
+            return 'Z';
+        case ConditionCode::POSITIVE:
+            return 'P';
+        default:
+            return '?';
+    }
+}
+
+uint64_t monotonic_nanoseconds() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
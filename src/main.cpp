@@ -1,9 +1,21 @@
+#include <unistd.h>  // isatty
+
+#include <cstdio>   // snprintf
+#include <cstdlib>  // getenv
+
 #include "assemble.cpp"
 #include "cli.cpp"
 #include "error.hpp"
 #include "execute.cpp"
+#include "fuzz.cpp"
+#include "query.cpp"
+#include "server.cpp"
+
+using namespace lasim::internal;
 
 Error try_run(Options &options);
+void write_symbols(const Options &options, Error &error);
+void read_symbols(const Options &options, Error &error);
 
 int main(const int argc, const char *const *const argv) {
     Options options;
@@ -31,6 +43,94 @@ Error try_run(Options &options) {
     if (options.debugger_quiet) {
         debugger_quiet = true;
     }
+    if (options.debug_script_filename[0] != '\0') {
+        load_debug_script(options.debug_script_filename, error);
+        if (error != Error::OK)
+            return error;
+    }
+    // Log is kept for every instruction, so only if asked for, or if a script
+    //     reverses
+    if (options.debugger &&
+        (options.undo_log_size > 0 || debug_script.has_reverse)) {
+        enable_undo_log(
+            options.undo_log_size > 0 ? options.undo_log_size
+                                      : UNDO_LOG_DEFAULT_SIZE
+        );
+    }
+    machine->limits = options.limits;
+    machine->detect_loops = options.detect_loops;
+    if (options.profile)
+        enable_profile();
+    if (options.callgraph_filename[0] != '\0') {
+        enable_callgraph(options.callgraph_filename, error);
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.heatmap_filename[0] != '\0') {
+        enable_heatmap(options.heatmap_filename, error);
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.instruction_cache_spec != nullptr) {
+        enable_cache(
+            instruction_cache,
+            "Instruction cache",
+            options.instruction_cache_spec,
+            error
+        );
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.data_cache_spec != nullptr) {
+        enable_cache(
+            data_cache, "Data cache", options.data_cache_spec, error
+        );
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.branch_predictor != nullptr) {
+        enable_branch_predictor(options.branch_predictor, error);
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.pipeline_spec != nullptr) {
+        enable_pipeline(options.pipeline_spec, error);
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.trace_filename[0] != '\0') {
+        enable_trace(options.trace_filename, error);
+        if (error != Error::OK)
+            return error;
+    }
+    if (options.coverage_filename != nullptr ||
+        options.lcov_filename[0] != '\0') {
+        const char *const bitmap = options.coverage_filename;
+        enable_coverage(
+            bitmap != nullptr && bitmap[0] != '\0' ? bitmap : nullptr,
+            options.lcov_filename[0] != '\0' ? options.lcov_filename
+                                             : nullptr,
+            error
+        );
+        if (error != Error::OK)
+            return error;
+    }
+    update_instrumented();
+    if (options.save_snapshot_filename[0] != '\0')
+        enable_save_snapshot(options.save_snapshot_filename);
+    // Default is only for a terminal, so scripts do not leave dumps behind
+    if (options.crash_dump && options.crash_dump_filename[0] == '\0' &&
+        isatty(STDERR_FILENO)) {
+        const char *const directory = getenv("TMPDIR");
+        snprintf(
+            options.crash_dump_filename,
+            FILENAME_MAX,
+            "%s/lasim.crash",
+            directory != nullptr && directory[0] != '\0' ? directory : "/tmp"
+        );
+    }
+    if (options.crash_dump && options.crash_dump_filename[0] != '\0')
+        enable_crash_dump(options.crash_dump_filename);
 
     switch (options.mode) {
         case Mode::ASSEMBLE_ONLY: {
@@ -39,12 +139,19 @@ Error try_run(Options &options) {
             assemble(options.in_filename, object, error);
             if (error != Error::OK)
                 return error;
+            write_symbols(options, error);
+            if (error != Error::OK)
+                return error;
         }; break;
 
         case Mode::EXECUTE_ONLY: {
             object.kind = ObjectFile::FILE;
             object.filename = options.in_filename;
+            read_symbols(options, error);
+            if (error != Error::OK)
+                return error;
             execute(object, options.debugger, error);
+            print_instrument_reports();
             if (error != Error::OK)
                 return error;
         }; break;
@@ -52,9 +159,65 @@ Error try_run(Options &options) {
         case Mode::ASSEMBLE_EXECUTE: {
             object.kind = ObjectFile::MEMORY;
             assemble(options.in_filename, object, error);
+            if (error != Error::OK)
+                return error;
+            write_symbols(options, error);
             if (error != Error::OK)
                 return error;
             execute(object, options.debugger, error);
+            print_instrument_reports();
+            if (error != Error::OK)
+                return error;
+        }; break;
+
+        case Mode::TRACE_QUERY: {
+            // Assembled only for labels, not executed
+            if (options.in_filename[0] != '\0') {
+                object.kind = ObjectFile::MEMORY;
+                assemble(options.in_filename, object, error);
+                if (error != Error::OK)
+                    return error;
+            }
+            read_symbols(options, error);
+            if (error != Error::OK)
+                return error;
+            run_trace_queries(options.trace_query_filename, error);
+            if (error != Error::OK)
+                return error;
+        }; break;
+
+        case Mode::RESUME: {
+            // Assembled only for labels, then replaced by snapshot
+            if (options.in_filename[0] != '\0') {
+                object.kind = ObjectFile::MEMORY;
+                assemble(options.in_filename, object, error);
+                if (error != Error::OK)
+                    return error;
+            }
+            read_symbols(options, error);
+            if (error != Error::OK)
+                return error;
+            object.kind = ObjectFile::SNAPSHOT;
+            object.filename = options.snapshot_filename;
+            execute(object, options.debugger, error);
+            print_instrument_reports();
+            if (error != Error::OK)
+                return error;
+        }; break;
+
+        case Mode::FUZZ: {
+            run_fuzzer(
+                options.fuzz_filename,
+                options.in_filename,
+                options.fuzz_runs,
+                error
+            );
+            if (error != Error::OK)
+                return error;
+        }; break;
+
+        case Mode::SERVE: {
+            serve(options.socket_filename, error);
             if (error != Error::OK)
                 return error;
         }; break;
@@ -62,3 +225,14 @@ Error try_run(Options &options) {
 
     return Error::OK;
 }
+
+// If `--symbols` was given
+void write_symbols(const Options &options, Error &error) {
+    if (options.symbols_filename[0] != '\0')
+        write_symbols_file(options.symbols_filename, error);
+}
+
+void read_symbols(const Options &options, Error &error) {
+    if (options.symbols_filename[0] != '\0')
+        read_symbols_file(options.symbols_filename, error);
+}
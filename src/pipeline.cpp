@@ -0,0 +1,273 @@
+#ifndef PIPELINE_CPP
+#define PIPELINE_CPP
+
+#include <cstdio>  // fprintf
+#include <vector>  // std::vector
+
+#include "bitmasks.hpp"
+#include "error.hpp"
+#include "globals.hpp"
+#include "profile.cpp"
+#include "spec.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Classic in-order 5-stage pipeline: fetch, decode, execute, memory, write
+// Each instruction takes 1 cycle, with full forwarding, plus stalls:
+//     - Load-use: instruction reads the register loaded by the previous
+//       instruction (`LD`, `LDR`, or `LDI`), or is a conditional branch after
+//       one, as loads set the condition from the loaded value in the memory
+//       stage. Other instructions which set the condition (including `LEA`)
+//       do so in the execute stage, so it is forwarded
+//     - Branch: control was transferred (predicted not taken, resolved late)
+//     - Memory: `accesses * memory - 1` cycles, as each data access takes
+//       `memory` cycles, of which the memory stage holds 1. So at 1 cycle per
+//       access, `LD` does not stall but `LDI` (2 accesses) stalls for 1, and
+//       `PUTS` for each character after the first
+// The pipeline must also be filled once, at the start
+
+#define PIPELINE_STAGES 5
+#define PIPELINE_HOTTEST_COUNT 10
+
+// Cycles of each stall kind
+typedef struct PipelineConfig {
+    size_t load_use;
+    size_t branch;
+    size_t memory;
+} PipelineConfig;
+
+typedef struct Pipeline {
+    bool is_enabled = false;
+    PipelineConfig config;
+
+    uint64_t instructions;
+    // Destination of previous instruction, if it was a load (which also set
+    //     the condition)
+    bool is_previous_load;
+    Register previous_load_register;
+    // Of current instruction
+    size_t data_accesses;
+
+    // Indexed by PC
+    vector<uint64_t> load_use_stalls;
+    vector<uint64_t> branch_stalls;
+    vector<uint64_t> memory_stalls;
+    vector<uint64_t> total_stalls;
+} Pipeline;
+
+static Pipeline pipeline;
+
+void enable_pipeline(const char *const spec, Error &error);
+void pipeline_access(const MemoryAccess access);
+void pipeline_instruction(const Word pc, const Word instr);
+void print_pipeline(FILE *const file);
+
+static bool parse_pipeline_config(const char *spec, PipelineConfig &config);
+static bool reads_register(const Word instr, const Register reg);
+static bool reads_condition(const Word instr);
+static bool is_control_transfer(const Word instr);
+
+// `spec` is comma-separated `KEY=CYCLES` fields, all optional:
+//     load=1  branch=2  memory=1
+void enable_pipeline(const char *const spec, Error &error) {
+    if (!parse_pipeline_config(spec, pipeline.config)) {
+        fprintf(stderr, "Invalid pipeline configuration: `%s`\n", spec);
+        SET_ERROR(error, CLI);
+        return;
+    }
+    pipeline.is_enabled = true;
+    pipeline.instructions = 0;
+    pipeline.is_previous_load = false;
+    pipeline.data_accesses = 0;
+    pipeline.load_use_stalls.assign(MEMORY_SIZE, 0);
+    pipeline.branch_stalls.assign(MEMORY_SIZE, 0);
+    pipeline.memory_stalls.assign(MEMORY_SIZE, 0);
+    pipeline.total_stalls.assign(MEMORY_SIZE, 0);
+}
+
+void pipeline_access(const MemoryAccess access) {
+    if (access != MemoryAccess::FETCH)
+        ++pipeline.data_accesses;
+}
+
+// Called after `instr` at `pc` executed
+void pipeline_instruction(const Word pc, const Word instr) {
+    const PipelineConfig &config = pipeline.config;
+    ++pipeline.instructions;
+
+    if (pipeline.is_previous_load &&
+        (reads_register(instr, pipeline.previous_load_register) ||
+         reads_condition(instr))) {
+        pipeline.load_use_stalls[pc] += config.load_use;
+        pipeline.total_stalls[pc] += config.load_use;
+    }
+
+    if (is_control_transfer(instr)) {
+        pipeline.branch_stalls[pc] += config.branch;
+        pipeline.total_stalls[pc] += config.branch;
+    }
+
+    if (pipeline.data_accesses > 0) {
+        const uint64_t stall = pipeline.data_accesses * config.memory - 1;
+        pipeline.memory_stalls[pc] += stall;
+        pipeline.total_stalls[pc] += stall;
+    }
+    pipeline.data_accesses = 0;
+
+    const Opcode opcode = static_cast<Opcode>(bits_12_15(instr));
+    pipeline.is_previous_load = opcode == Opcode::LD || opcode == Opcode::LDR ||
+                                opcode == Opcode::LDI;
+    pipeline.previous_load_register = bits_9_11(instr);
+}
+
+void print_pipeline(FILE *const file) {
+    const PipelineConfig &config = pipeline.config;
+    uint64_t load_use = 0;
+    uint64_t branch = 0;
+    uint64_t memory = 0;
+    for (size_t i = 0; i < MEMORY_SIZE; ++i) {
+        load_use += pipeline.load_use_stalls[i];
+        branch += pipeline.branch_stalls[i];
+        memory += pipeline.memory_stalls[i];
+    }
+    const uint64_t instructions = pipeline.instructions;
+    const uint64_t fill = instructions > 0 ? PIPELINE_STAGES - 1 : 0;
+    const uint64_t cycles = instructions + fill + load_use + branch + memory;
+
+    fprintf(
+        file,
+        "\nPipeline (load-use %zu, branch %zu, memory %zu cycles): "
+        "%lu cycles, %lu instructions",
+        config.load_use,
+        config.branch,
+        config.memory,
+        static_cast<unsigned long>(cycles),
+        static_cast<unsigned long>(instructions)
+    );
+    if (instructions > 0) {
+        const double cpi = static_cast<double>(cycles) / instructions;
+        fprintf(file, " (%.2f CPI)", cpi);
+    }
+    fprintf(file, "\n");
+    fprintf(
+        file,
+        "    Stalls: %lu load-use, %lu branch, %lu memory, %lu fill\n",
+        static_cast<unsigned long>(load_use),
+        static_cast<unsigned long>(branch),
+        static_cast<unsigned long>(memory),
+        static_cast<unsigned long>(fill)
+    );
+
+    Word hottest[PIPELINE_HOTTEST_COUNT];
+    const size_t hottest_count = find_hottest_addresses(
+        pipeline.total_stalls.data(), hottest, PIPELINE_HOTTEST_COUNT
+    );
+    if (hottest_count == 0)
+        return;
+    fprintf(file, "    Most stalls by instruction:\n");
+    fprintf(
+        file,
+        "       LOAD-USE       BRANCH       MEMORY       PC  LINE  LABEL\n"
+    );
+    for (size_t i = 0; i < hottest_count; ++i) {
+        const Word pc = hottest[i];
+        fprintf(
+            file,
+            "    %11lu  %11lu  %11lu   0x%04hx",
+            static_cast<unsigned long>(pipeline.load_use_stalls[pc]),
+            static_cast<unsigned long>(pipeline.branch_stalls[pc]),
+            static_cast<unsigned long>(pipeline.memory_stalls[pc]),
+            pc
+        );
+        print_address_location(file, pc);
+        fprintf(file, "\n");
+    }
+}
+
+static bool parse_pipeline_config(const char *spec, PipelineConfig &config) {
+    config.load_use = 1;
+    config.branch = 2;
+    config.memory = 1;
+
+    while (*spec != '\0') {
+        const char *value;
+        size_t *field;
+        if (parse_spec_field(spec, "load", value))
+            field = &config.load_use;
+        else if (parse_spec_field(spec, "branch", value))
+            field = &config.branch;
+        else if (parse_spec_field(spec, "memory", value))
+            field = &config.memory;
+        else
+            return false;
+        if (!parse_spec_number(value, spec, *field))
+            return false;
+
+        if (*spec == ',')
+            ++spec;
+    }
+    // Memory stage takes at least 1 cycle
+    return config.memory > 0;
+}
+
+// Whether `instr` needs value of `reg` in execute or memory stage
+static bool reads_register(const Word instr, const Register reg) {
+    switch (static_cast<Opcode>(bits_12_15(instr))) {
+        case Opcode::ADD:
+        case Opcode::AND:
+            // Immediate mode does not read second register
+            if (bits_6_8(instr) == reg)
+                return true;
+            return bit_5(instr) == 0b0 && bits_0_2(instr) == reg;
+        case Opcode::NOT:
+        case Opcode::JMP_RET:
+        case Opcode::LDR:
+            return bits_6_8(instr) == reg;
+        case Opcode::JSR_JSRR:
+            return bit_11(instr) == 0b0 && bits_6_8(instr) == reg;
+        case Opcode::ST:
+        case Opcode::STI:
+            return bits_9_11(instr) == reg;
+        case Opcode::STR:
+            return bits_9_11(instr) == reg || bits_6_8(instr) == reg;
+        case Opcode::TRAP:
+            // Output traps read `R0`
+            return reg == 0;
+        default:
+            return false;
+    }
+}
+
+// Whether `instr` needs the condition in execute stage, so after a load
+// `BRnzp` and `NOP` do not depend on it
+static bool reads_condition(const Word instr) {
+    return static_cast<Opcode>(bits_12_15(instr)) == Opcode::BR &&
+           bits_9_11(instr) != 0b000 && bits_9_11(instr) != 0b111;
+}
+
+// Taken branch, jump, subroutine call, or trap
+static bool is_control_transfer(const Word instr) {
+    switch (static_cast<Opcode>(bits_12_15(instr))) {
+        case Opcode::BR: {
+            const Word condition_mask = bits_9_11(instr);
+            const Word condition =
+                static_cast<Word>(machine->registers.condition);
+            return (condition_mask & condition) != 0;
+        }
+        case Opcode::JMP_RET:
+        case Opcode::JSR_JSRR:
+        case Opcode::TRAP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
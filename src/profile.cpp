@@ -0,0 +1,251 @@
+#ifndef PROFILE_CPP
+#define PROFILE_CPP
+
+#include <cstdio>  // fprintf
+#include <vector>  // std::vector
+
+#include "bitmasks.hpp"
+#include "symbols.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Amount of addresses to list as hottest
+#define PROFILE_HOTTEST_COUNT 10
+
+// Execution counts, indexed directly by PC, opcode, and trap vector
+typedef struct Profile {
+    bool is_enabled = false;
+    uint64_t total;
+    vector<uint64_t> address_counts;  // `MEMORY_SIZE` once enabled
+    uint64_t opcode_counts[16];
+    uint64_t trap_counts[256];
+} Profile;
+
+static Profile profile;
+
+// Indexed by opcode value
+static const char *const OPCODE_NAMES[] = {
+    "BR",
+    "ADD",
+    "LD",
+    "ST",
+    "JSR",
+    "AND",
+    "LDR",
+    "STR",
+    "RTI",
+    "NOT",
+    "LDI",
+    "STI",
+    "JMP",
+    "RESERVED",
+    "LEA",
+    "TRAP",
+};
+
+void enable_profile(void);
+void profile_instruction(const Word pc, const Word instr);
+void print_profile(FILE *const file);
+
+static void print_profile_hottest(FILE *const file);
+static void print_profile_opcodes(FILE *const file);
+static void print_profile_listing(FILE *const file);
+size_t find_hottest_addresses(
+    const uint64_t *const counts, Word *const hottest, const size_t max_count
+);
+void print_address_location(FILE *const file, const Word address);
+const char *trap_vector_name(const uint8_t vector);
+
+void enable_profile() {
+    profile.is_enabled = true;
+    profile.total = 0;
+    profile.address_counts.assign(MEMORY_SIZE, 0);
+    for (size_t i = 0; i < 16; ++i)
+        profile.opcode_counts[i] = 0;
+    for (size_t i = 0; i < 256; ++i)
+        profile.trap_counts[i] = 0;
+}
+
+void profile_instruction(const Word pc, const Word instr) {
+    ++profile.total;
+    ++profile.address_counts[pc];
+    const Word opcode = instr >> 12;
+    ++profile.opcode_counts[opcode];
+    if (opcode == static_cast<Word>(Opcode::TRAP))
+        ++profile.trap_counts[instr & BITMASK_LOW_8];
+}
+
+void print_profile(FILE *const file) {
+    fprintf(
+        file,
+        "\nProfile: %lu instructions\n",
+        static_cast<unsigned long>(profile.total)
+    );
+    if (profile.total == 0)
+        return;
+    print_profile_hottest(file);
+    print_profile_opcodes(file);
+    // Not if loaded from a symbols file, without source
+    if (symbols.is_loaded && source_line_count() > 0)
+        print_profile_listing(file);
+}
+
+static void print_profile_hottest(FILE *const file) {
+    Word hottest[PROFILE_HOTTEST_COUNT];
+    const size_t hottest_count = find_hottest_addresses(
+        profile.address_counts.data(), hottest, PROFILE_HOTTEST_COUNT
+    );
+
+    fprintf(file, "\nHottest addresses:\n");
+    fprintf(file, "      COUNT       %%  ADDRESS  LINE  LABEL\n");
+    for (size_t i = 0; i < hottest_count; ++i) {
+        const uint64_t count = profile.address_counts[hottest[i]];
+        fprintf(
+            file,
+            "%11lu  %5.1f%%   0x%04hx",
+            static_cast<unsigned long>(count),
+            100.0 * count / profile.total,
+            hottest[i]
+        );
+        print_address_location(file, hottest[i]);
+        fprintf(file, "\n");
+    }
+}
+
+static void print_profile_opcodes(FILE *const file) {
+    fprintf(file, "\nOpcodes:\n");
+    for (size_t i = 0; i < 16; ++i) {
+        const uint64_t count = profile.opcode_counts[i];
+        if (count == 0)
+            continue;
+        fprintf(
+            file,
+            "    %-8s %11lu  %5.1f%%\n",
+            OPCODE_NAMES[i],
+            static_cast<unsigned long>(count),
+            100.0 * count / profile.total
+        );
+    }
+
+    bool has_traps = false;
+    for (size_t i = 0; i < 256; ++i) {
+        const uint64_t count = profile.trap_counts[i];
+        if (count == 0)
+            continue;
+        if (!has_traps)
+            fprintf(file, "\nTraps:\n");
+        has_traps = true;
+        const char *const name = trap_vector_name(static_cast<uint8_t>(i));
+        if (name != nullptr)
+            fprintf(file, "    %-8s", name);
+        else
+            fprintf(file, "    x%02zx     ", i);
+        fprintf(file, " %11lu\n", static_cast<unsigned long>(count));
+    }
+}
+
+// Every source line, with total count of its words
+// Lines without any words are not given a count
+static void print_profile_listing(FILE *const file) {
+    const size_t line_count = source_line_count();
+    vector<uint64_t> line_counts(line_count + 1, 0);
+    vector<bool> line_has_words(line_count + 1, false);
+    for (size_t i = 0; i < symbols.line_numbers.size(); ++i) {
+        const size_t line = symbols.line_numbers[i];
+        if (line > line_count)
+            continue;
+        line_counts[line] += profile.address_counts[symbols.origin + i];
+        line_has_words[line] = true;
+    }
+
+    fprintf(file, "\nAnnotated listing:\n");
+    for (size_t line = 1; line <= line_count; ++line) {
+        if (line_has_words[line]) {
+            fprintf(
+                file, "%11lu", static_cast<unsigned long>(line_counts[line])
+            );
+        } else {
+            fprintf(file, "%11s", "");
+        }
+        const StringSlice source = source_line(line);
+        fprintf(file, " %5zu |", line);
+        if (source.length > 0)
+            fprintf(file, " ");
+        print_string_slice(file, source);
+        fprintf(file, "\n");
+    }
+}
+
+// Addresses with highest non-zero `counts` (indexed by address), descending
+// Returns amount written to `hottest`
+size_t find_hottest_addresses(
+    const uint64_t *const counts, Word *const hottest, const size_t max_count
+) {
+    // Insertion into a short sorted list, as most addresses are never used
+    size_t hottest_count = 0;
+    for (size_t address = 0; address < MEMORY_SIZE; ++address) {
+        const uint64_t count = counts[address];
+        if (count == 0)
+            continue;
+        size_t i = hottest_count;
+        while (i > 0 && counts[hottest[i - 1]] < count) {
+            if (i < max_count)
+                hottest[i] = hottest[i - 1];
+            --i;
+        }
+        if (i < max_count) {
+            hottest[i] = static_cast<Word>(address);
+            if (hottest_count < max_count)
+                ++hottest_count;
+        }
+    }
+    return hottest_count;
+}
+
+// Line number and nearest label, if known
+void print_address_location(FILE *const file, const Word address) {
+    const int line = find_line_number(address);
+    if (line > 0)
+        fprintf(file, "  %4d", line);
+    else
+        fprintf(file, "  %4s", "");
+
+    const Symbol *const symbol = find_symbol_before(address);
+    if (symbol == nullptr)
+        return;
+    fprintf(file, "  %s", symbol->name);
+    if (address != symbol->address)
+        fprintf(file, "+%d", address - symbol->address);
+}
+
+// `nullptr` if not a known trap
+const char *trap_vector_name(const uint8_t vector) {
+    switch (static_cast<TrapVector>(vector)) {
+        case TrapVector::GETC:
+            return "GETC";
+        case TrapVector::OUT:
+            return "OUT";
+        case TrapVector::PUTS:
+            return "PUTS";
+        case TrapVector::IN:
+            return "IN";
+        case TrapVector::PUTSP:
+            return "PUTSP";
+        case TrapVector::HALT:
+            return "HALT";
+        case TrapVector::REG:
+            return "REG";
+        case TrapVector::DEBUG:
+            return "DEBUG";
+    }
+    return nullptr;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,707 @@
+#ifndef QUERY_CPP
+#define QUERY_CPP
+
+#include <sys/stat.h>  // fstat
+
+#include <cstdio>   // fprintf, fopen, fread, fgets
+#include <cstring>  // memcmp, memcpy, strlen
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "machine.cpp"
+#include "slice.cpp"
+#include "symbols.cpp"
+#include "token.cpp"
+#include "trace.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+#define TRACE_INDEX_MAGIC "LCTRIDX\x02"
+#define TRACE_INDEX_EXTENSION ".idx"
+
+// Bytes at each end of the trace which are hashed, to identify it
+#define TRACE_HASH_BLOCK 4096
+
+// Decoder state is saved every this many instructions, so the state at any
+//     step is found by decoding at most this many records
+#define TRACE_CHECKPOINT_INTERVAL 4096
+
+#define MAX_QUERY 256  // Includes '\0'
+
+// Value of a memory word or register, from a step onwards
+// Steps count from 1, for the first instruction executed
+typedef struct TraceEvent {
+    uint64_t step;
+    Word value;
+} TraceEvent;
+
+// Decoder state before a record
+typedef struct TraceCheckpoint {
+    uint64_t offset;  // From start of trace file
+    Word pc;
+    Word registers[GP_REGISTER_COUNT];
+    Word write_addr;
+} TraceCheckpoint;
+
+// Index is rebuilt if any of these differ from the trace file
+// Size and time alone miss a trace rewritten within the timestamp granularity,
+//     or copied with its time, so the header and last records are hashed
+typedef struct TraceIdentity {
+    uint64_t size;
+    int64_t mtime_seconds;
+    int64_t mtime_nanoseconds;
+    uint64_t hash;  // FNV-1a of first and last `TRACE_HASH_BLOCK` bytes
+} TraceIdentity;
+
+// Index file is this, followed by the arrays of `TraceIndex` in order
+// Native byte order, as the index is a cache for the machine it was built on
+typedef struct TraceIndexHeader {
+    char magic[8];
+    TraceIdentity trace;
+    uint64_t record_count;
+    uint64_t write_count;
+    uint64_t change_count;
+    uint64_t checkpoint_count;
+} TraceIndexHeader;
+
+// Arrays point into `data`, which holds the whole index file
+typedef struct TraceIndex {
+    vector<uint64_t> data;  // `uint64_t` for alignment
+    TraceIndexHeader header;
+
+    // Indexed by PC, with steps of 0 if never executed
+    const uint64_t *pc_firsts;  // `MEMORY_SIZE` of each
+    const uint64_t *pc_lasts;
+    const uint64_t *pc_counts;
+    // Writes to `addr` are `writes[write_starts[addr]]` until
+    //     `writes[write_starts[addr + 1]]`, in order of step
+    const uint64_t *write_starts;  // `MEMORY_SIZE + 1`
+    const TraceEvent *writes;
+    // Changes to each register, likewise
+    const uint64_t *change_starts;  // `GP_REGISTER_COUNT + 1`
+    const TraceEvent *changes;
+    // One per `TRACE_CHECKPOINT_INTERVAL` steps, from step 1
+    const TraceCheckpoint *checkpoints;
+} TraceIndex;
+
+// Memory write, before being grouped by address
+typedef struct TraceWrite {
+    Word addr;
+    TraceEvent event;
+} TraceWrite;
+
+enum class TraceQuery {
+    UNKNOWN,
+    WRITE,
+    WRITES,
+    REGISTER,
+    REACH,
+    STATE,
+    HELP,
+};
+
+// Answers queries from stdin, building index `TRACE.idx` if needed
+void run_trace_queries(const char *const trace_filename, Error &error);
+
+static bool read_trace_identity(FILE *const file, TraceIdentity &identity);
+static bool load_trace_index(
+    const char *const filename,
+    const TraceIdentity &identity,
+    TraceIndex &index
+);
+static void build_trace_index(
+    FILE *const trace_file,
+    const TraceIdentity &identity,
+    const char *const filename,
+    Error &error
+);
+static void write_trace_index(
+    FILE *const file,
+    const TraceIndexHeader &header,
+    const vector<uint64_t> &pc_firsts,
+    const vector<uint64_t> &pc_lasts,
+    const vector<uint64_t> &pc_counts,
+    const vector<TraceWrite> &writes,
+    const vector<TraceEvent> *const changes,
+    const vector<TraceCheckpoint> &checkpoints
+);
+static void run_trace_query(
+    const char *line, const TraceIndex &index, FILE *const trace_file
+);
+static void query_trace_state(
+    const uint64_t step, const TraceIndex &index, FILE *const trace_file
+);
+static TraceQuery take_trace_query(const char *&line);
+static bool take_query_address(const char *&line, Word &addr);
+static bool take_query_register(const char *&line, Register &reg);
+static bool take_query_step(const char *&line, uint64_t &step);
+static size_t count_events_before(
+    const TraceEvent *const events, const size_t count, const uint64_t step
+);
+static void print_trace_event(const TraceEvent &event);
+
+void run_trace_queries(const char *const trace_filename, Error &error) {
+    FILE *const trace_file = fopen(trace_filename, "rb");
+    if (trace_file == nullptr) {
+        fprintf(stderr, "Failed to open trace file: %s\n", trace_filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    TraceIdentity identity;
+    if (!read_trace_identity(trace_file, identity)) {
+        fprintf(stderr, "Failed to read trace file: %s\n", trace_filename);
+        fclose(trace_file);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    char index_filename[FILENAME_MAX + sizeof(TRACE_INDEX_EXTENSION)];
+    snprintf(
+        index_filename,
+        sizeof(index_filename),
+        "%s" TRACE_INDEX_EXTENSION,
+        trace_filename
+    );
+
+    TraceIndex index;
+    if (!load_trace_index(index_filename, identity, index)) {
+        build_trace_index(trace_file, identity, index_filename, error);
+        if (error != Error::OK) {
+            fclose(trace_file);
+            return;
+        }
+        if (!load_trace_index(index_filename, identity, index)) {
+            fprintf(
+                stderr, "Failed to read trace index: %s\n", index_filename
+            );
+            fclose(trace_file);
+            SET_ERROR(error, FILE);
+            return;
+        }
+    }
+
+    char line[MAX_QUERY];
+    while (fgets(line, MAX_QUERY, stdin) != nullptr) {
+        run_trace_query(line, index, trace_file);
+        fflush(stdout);
+    }
+    fclose(trace_file);
+}
+
+// `false` if unreadable
+static bool read_trace_identity(FILE *const file, TraceIdentity &identity) {
+    struct stat info;
+    if (fstat(fileno(file), &info) != 0)
+        return false;
+    identity.size = info.st_size;
+    identity.mtime_seconds = info.st_mtim.tv_sec;
+    identity.mtime_nanoseconds = info.st_mtim.tv_nsec;
+
+    // Blocks overlap if the trace is small
+    uint8_t block[TRACE_HASH_BLOCK];
+    uint64_t hash = 14695981039346656037ull;
+    const uint64_t length =
+        identity.size < TRACE_HASH_BLOCK ? identity.size : TRACE_HASH_BLOCK;
+    const uint64_t offsets[2] = {0, identity.size - length};
+    for (size_t i = 0; i < 2; ++i) {
+        fseek(file, offsets[i], SEEK_SET);
+        if (fread(block, 1, length, file) != length)
+            return false;
+        for (size_t j = 0; j < length; ++j)
+            hash = (hash ^ block[j]) * 1099511628211ull;
+    }
+    identity.hash = hash;
+    return true;
+}
+
+// `false` if missing, invalid, or for a different trace
+// Whole file is read at once, then the arrays are used in place
+static bool load_trace_index(
+    const char *const filename,
+    const TraceIdentity &identity,
+    TraceIndex &index
+) {
+    FILE *const file = fopen(filename, "rb");
+    if (file == nullptr)
+        return false;
+    fseek(file, 0, SEEK_END);
+    const uint64_t size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    TraceIndexHeader &header = index.header;
+    if (size < sizeof(header) || fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TRACE_INDEX_MAGIC, sizeof(header.magic)) ||
+        header.trace.size != identity.size ||
+        header.trace.mtime_seconds != identity.mtime_seconds ||
+        header.trace.mtime_nanoseconds != identity.mtime_nanoseconds ||
+        header.trace.hash != identity.hash) {
+        fclose(file);
+        return false;
+    }
+    const uint64_t expected_size =
+        sizeof(header) + 3 * MEMORY_SIZE * sizeof(uint64_t) +
+        (MEMORY_SIZE + 1) * sizeof(uint64_t) +
+        header.write_count * sizeof(TraceEvent) +
+        (GP_REGISTER_COUNT + 1) * sizeof(uint64_t) +
+        header.change_count * sizeof(TraceEvent) +
+        header.checkpoint_count * sizeof(TraceCheckpoint);
+    if (size != expected_size) {
+        fclose(file);
+        return false;
+    }
+
+    const size_t data_size = size - sizeof(header);
+    index.data.resize(data_size / sizeof(uint64_t));
+    const bool is_read = fread(index.data.data(), 1, data_size, file) ==
+                         data_size;
+    fclose(file);
+    if (!is_read)
+        return false;
+
+    const uint64_t *const data = index.data.data();
+    index.pc_firsts = data;
+    index.pc_lasts = index.pc_firsts + MEMORY_SIZE;
+    index.pc_counts = index.pc_lasts + MEMORY_SIZE;
+    index.write_starts = index.pc_counts + MEMORY_SIZE;
+    index.writes = reinterpret_cast<const TraceEvent *>(
+        index.write_starts + MEMORY_SIZE + 1
+    );
+    index.change_starts = reinterpret_cast<const uint64_t *>(
+        index.writes + header.write_count
+    );
+    index.changes = reinterpret_cast<const TraceEvent *>(
+        index.change_starts + GP_REGISTER_COUNT + 1
+    );
+    index.checkpoints = reinterpret_cast<const TraceCheckpoint *>(
+        index.changes + header.change_count
+    );
+    return true;
+}
+
+static void build_trace_index(
+    FILE *const trace_file,
+    const TraceIdentity &identity,
+    const char *const filename,
+    Error &error
+) {
+    const uint64_t trace_size = identity.size;
+    vector<uint8_t> trace_data(trace_size);
+    fseek(trace_file, 0, SEEK_SET);
+    if (fread(trace_data.data(), 1, trace_size, trace_file) != trace_size ||
+        trace_size < TRACE_MAGIC_SIZE ||
+        memcmp(trace_data.data(), TRACE_MAGIC, TRACE_MAGIC_SIZE)) {
+        fprintf(stderr, "Not a valid trace file\n");
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    vector<uint64_t> pc_firsts(MEMORY_SIZE, 0);
+    vector<uint64_t> pc_lasts(MEMORY_SIZE, 0);
+    vector<uint64_t> pc_counts(MEMORY_SIZE, 0);
+    vector<TraceWrite> writes;
+    vector<TraceEvent> changes[GP_REGISTER_COUNT];
+    vector<TraceCheckpoint> checkpoints;
+
+    TraceDecoder decoder;
+    start_trace_decoder(
+        decoder,
+        trace_data.data() + TRACE_MAGIC_SIZE,
+        trace_size - TRACE_MAGIC_SIZE
+    );
+    uint64_t step = 0;
+    bool is_invalid = false;
+    while (true) {
+        if (step % TRACE_CHECKPOINT_INTERVAL == 0) {
+            checkpoints.push_back({});
+            TraceCheckpoint &checkpoint = checkpoints.back();
+            checkpoint.offset = decoder.offset + TRACE_MAGIC_SIZE;
+            checkpoint.pc = decoder.pc;
+            memcpy(
+                checkpoint.registers,
+                decoder.registers,
+                sizeof(checkpoint.registers)
+            );
+            checkpoint.write_addr = decoder.write_addr;
+        }
+        if (!decode_trace_record(decoder, is_invalid))
+            break;
+        ++step;
+
+        const Word pc = decoder.pc;
+        if (pc_firsts[pc] == 0)
+            pc_firsts[pc] = step;
+        pc_lasts[pc] = step;
+        ++pc_counts[pc];
+        for (size_t i = 0; i < GP_REGISTER_COUNT; ++i) {
+            if (decoder.changed_registers & 1 << i)
+                changes[i].push_back({step, decoder.registers[i]});
+        }
+        if (decoder.has_write) {
+            writes.push_back(
+                {decoder.write_addr, {step, decoder.write_value}}
+            );
+        }
+    }
+    if (is_invalid) {
+        fprintf(
+            stderr,
+            "Trace is malformed after %lu instructions\n",
+            static_cast<unsigned long>(step)
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+    // Checkpoint taken after the last record has no records to decode
+    if (step % TRACE_CHECKPOINT_INTERVAL == 0)
+        checkpoints.pop_back();
+
+    TraceIndexHeader header;
+    memcpy(header.magic, TRACE_INDEX_MAGIC, sizeof(header.magic));
+    header.trace = identity;
+    header.record_count = step;
+    header.write_count = writes.size();
+    header.change_count = 0;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        header.change_count += changes[i].size();
+    header.checkpoint_count = checkpoints.size();
+
+    FILE *const file = fopen(filename, "wb");
+    if (file == nullptr) {
+        fprintf(
+            stderr, "Failed to open trace index for writing: %s\n", filename
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+    write_trace_index(
+        file,
+        header,
+        pc_firsts,
+        pc_lasts,
+        pc_counts,
+        writes,
+        changes,
+        checkpoints
+    );
+    if (ferror(file) || fclose(file) != 0) {
+        fprintf(stderr, "Failed to write trace index: %s\n", filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    fprintf(
+        stderr,
+        "Indexed %lu instructions to %s\n",
+        static_cast<unsigned long>(step),
+        filename
+    );
+}
+
+// Writes are grouped by address, keeping order of step
+static void write_trace_index(
+    FILE *const file,
+    const TraceIndexHeader &header,
+    const vector<uint64_t> &pc_firsts,
+    const vector<uint64_t> &pc_lasts,
+    const vector<uint64_t> &pc_counts,
+    const vector<TraceWrite> &writes,
+    const vector<TraceEvent> *const changes,
+    const vector<TraceCheckpoint> &checkpoints
+) {
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(pc_firsts.data(), sizeof(uint64_t), MEMORY_SIZE, file);
+    fwrite(pc_lasts.data(), sizeof(uint64_t), MEMORY_SIZE, file);
+    fwrite(pc_counts.data(), sizeof(uint64_t), MEMORY_SIZE, file);
+
+    vector<uint64_t> write_starts(MEMORY_SIZE + 1, 0);
+    for (size_t i = 0; i < writes.size(); ++i)
+        ++write_starts[writes[i].addr + 1];
+    for (size_t i = 0; i < MEMORY_SIZE; ++i)
+        write_starts[i + 1] += write_starts[i];
+    vector<uint64_t> write_ends(write_starts.begin(), write_starts.end() - 1);
+    vector<TraceEvent> grouped_writes(writes.size());
+    for (size_t i = 0; i < writes.size(); ++i)
+        grouped_writes[write_ends[writes[i].addr]++] = writes[i].event;
+    fwrite(write_starts.data(), sizeof(uint64_t), MEMORY_SIZE + 1, file);
+    fwrite(grouped_writes.data(), sizeof(TraceEvent), writes.size(), file);
+
+    uint64_t change_starts[GP_REGISTER_COUNT + 1] = {0};
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        change_starts[i + 1] = change_starts[i] + changes[i].size();
+    fwrite(change_starts, sizeof(uint64_t), GP_REGISTER_COUNT + 1, file);
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        fwrite(changes[i].data(), sizeof(TraceEvent), changes[i].size(), file);
+
+    fwrite(
+        checkpoints.data(), sizeof(TraceCheckpoint), checkpoints.size(), file
+    );
+}
+
+// Prints answer to stdout, or message to stderr if invalid
+static void run_trace_query(
+    const char *line, const TraceIndex &index, FILE *const trace_file
+) {
+    const TraceQuery query = take_trace_query(line);
+    const uint64_t record_count = index.header.record_count;
+
+    switch (query) {
+        // `write ADDR [before STEP]`: Last write
+        case TraceQuery::WRITE: {
+            Word addr;
+            if (!take_query_address(line, addr))
+                return;
+            uint64_t step = record_count + 1;
+            if (take_keyword(line, "before")) {
+                if (!take_query_step(line, step))
+                    return;
+            }
+            const TraceEvent *const events =
+                index.writes + index.write_starts[addr];
+            const size_t count = count_events_before(
+                events,
+                index.write_starts[addr + 1] - index.write_starts[addr],
+                step
+            );
+            if (count == 0)
+                printf("none\n");
+            else
+                print_trace_event(events[count - 1]);
+        }; break;
+
+        // `writes ADDR`: All writes
+        case TraceQuery::WRITES: {
+            Word addr;
+            if (!take_query_address(line, addr))
+                return;
+            const uint64_t start = index.write_starts[addr];
+            const uint64_t end = index.write_starts[addr + 1];
+            if (start == end)
+                printf("none\n");
+            for (uint64_t i = start; i < end; ++i)
+                print_trace_event(index.writes[i]);
+        }; break;
+
+        // `reg REGISTER [at STEP]`: Value after step, or all values held
+        // Registers start as 0, from step 0
+        case TraceQuery::REGISTER: {
+            Register reg;
+            if (!take_query_register(line, reg))
+                return;
+            const TraceEvent *const events =
+                index.changes + index.change_starts[reg];
+            const size_t count =
+                index.change_starts[reg + 1] - index.change_starts[reg];
+            if (take_keyword(line, "at")) {
+                uint64_t step;
+                if (!take_query_step(line, step))
+                    return;
+                const size_t before =
+                    count_events_before(events, count, step + 1);
+                if (before == 0)
+                    print_trace_event({0, 0});
+                else
+                    print_trace_event(events[before - 1]);
+            } else {
+                print_trace_event({0, 0});
+                for (size_t i = 0; i < count; ++i)
+                    print_trace_event(events[i]);
+            }
+        }; break;
+
+        // `reach ADDR`: First and last step at PC
+        case TraceQuery::REACH: {
+            Word addr;
+            if (!take_query_address(line, addr))
+                return;
+            if (index.pc_counts[addr] == 0) {
+                printf("none\n");
+                return;
+            }
+            printf(
+                "first %lu last %lu count %lu\n",
+                static_cast<unsigned long>(index.pc_firsts[addr]),
+                static_cast<unsigned long>(index.pc_lasts[addr]),
+                static_cast<unsigned long>(index.pc_counts[addr])
+            );
+        }; break;
+
+        // `state STEP`: PC of instruction, and registers after it
+        case TraceQuery::STATE: {
+            uint64_t step;
+            if (!take_query_step(line, step))
+                return;
+            if (step < 1 || step > record_count) {
+                fprintf(
+                    stderr,
+                    "Step is out of range: 1 to %lu\n",
+                    static_cast<unsigned long>(record_count)
+                );
+                return;
+            }
+            query_trace_state(step, index, trace_file);
+        }; break;
+
+        case TraceQuery::HELP:
+            printf(
+                "write ADDR [before STEP]   Last write to ADDR\n"
+                "writes ADDR                All writes to ADDR\n"
+                "reg REGISTER [at STEP]     All values of REGISTER, or value "
+                "after STEP\n"
+                "reach ADDR                 First and last step at ADDR\n"
+                "state STEP                 PC and registers of STEP\n"
+                "ADDR is an integer or label\n"
+            );
+            break;
+
+        case TraceQuery::UNKNOWN:
+            fprintf(stderr, "Invalid query. Use `help` to show queries\n");
+            break;
+    }
+}
+
+// Decodes from nearest checkpoint, reading only the records needed
+static void query_trace_state(
+    const uint64_t step, const TraceIndex &index, FILE *const trace_file
+) {
+    const size_t checkpoint_index = (step - 1) / TRACE_CHECKPOINT_INTERVAL;
+    const TraceCheckpoint &checkpoint = index.checkpoints[checkpoint_index];
+    uint64_t size = index.header.trace.size - checkpoint.offset;
+    if (size > TRACE_CHECKPOINT_INTERVAL * TRACE_RECORD_MAX)
+        size = TRACE_CHECKPOINT_INTERVAL * TRACE_RECORD_MAX;
+
+    vector<uint8_t> data(size);
+    fseek(trace_file, checkpoint.offset, SEEK_SET);
+    if (fread(data.data(), 1, size, trace_file) != size) {
+        fprintf(stderr, "Failed to read trace file\n");
+        return;
+    }
+
+    TraceDecoder decoder;
+    start_trace_decoder(decoder, data.data(), size);
+    decoder.pc = checkpoint.pc;
+    memcpy(decoder.registers, checkpoint.registers, sizeof(decoder.registers));
+    decoder.write_addr = checkpoint.write_addr;
+
+    bool is_invalid = false;
+    const uint64_t first_step = checkpoint_index * TRACE_CHECKPOINT_INTERVAL;
+    for (uint64_t i = first_step; i < step; ++i) {
+        if (!decode_trace_record(decoder, is_invalid)) {
+            fprintf(stderr, "Trace is malformed\n");
+            return;
+        }
+    }
+
+    printf(
+        "step %lu pc x%04hx cc %c",
+        static_cast<unsigned long>(step),
+        decoder.pc,
+        condition_char(decoder.condition)
+    );
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        printf(" r%zu x%04hx", i, decoder.registers[i]);
+    printf("\n");
+}
+
+static TraceQuery take_trace_query(const char *&line) {
+    if (take_keyword(line, "write"))
+        return TraceQuery::WRITE;
+    if (take_keyword(line, "writes"))
+        return TraceQuery::WRITES;
+    if (take_keyword(line, "reg"))
+        return TraceQuery::REGISTER;
+    if (take_keyword(line, "reach"))
+        return TraceQuery::REACH;
+    if (take_keyword(line, "state"))
+        return TraceQuery::STATE;
+    if (take_keyword(line, "help") || take_keyword(line, "h"))
+        return TraceQuery::HELP;
+    return TraceQuery::UNKNOWN;
+}
+
+// Integer, or label if program was assembled
+static bool take_query_address(const char *&line, Word &addr) {
+    take_whitespace(line);
+    InitialSignWord integer;
+    if (take_integer(line, integer) == 1 && !integer.is_signed) {
+        addr = integer.value;
+        return true;
+    }
+
+    StringSlice name = {line, 0};
+    while (is_char_valid_in_identifier(line[name.length]))
+        ++name.length;
+    const Symbol *const symbol =
+        name.length > 0 ? find_symbol(name) : nullptr;
+    if (symbol == nullptr) {
+        fprintf(stderr, "Expected address or label\n");
+        return false;
+    }
+    line += name.length;
+    addr = symbol->address;
+    return true;
+}
+
+static bool take_query_register(const char *&line, Register &reg) {
+    take_whitespace(line);
+    if ((line[0] != 'r' && line[0] != 'R') || line[1] < '0' ||
+        line[1] >= '0' + GP_REGISTER_COUNT ||
+        is_char_valid_in_identifier(line[2])) {
+        fprintf(stderr, "Expected register\n");
+        return false;
+    }
+    reg = line[1] - '0';
+    line += 2;
+    return true;
+}
+
+// Decimal
+static bool take_query_step(const char *&line, uint64_t &step) {
+    take_whitespace(line);
+    step = 0;
+    size_t i = 0;
+    for (; line[i] >= '0' && line[i] <= '9'; ++i) {
+        if (step > UINT64_MAX / 10) {
+            fprintf(stderr, "Step is too large\n");
+            return false;
+        }
+        step = step * 10 + (line[i] - '0');
+    }
+    if (i == 0) {
+        fprintf(stderr, "Expected step\n");
+        return false;
+    }
+    line += i;
+    return true;
+}
+
+// Binary search, as events are in order of step
+static size_t count_events_before(
+    const TraceEvent *const events, const size_t count, const uint64_t step
+) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (events[middle].step < step)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static void print_trace_event(const TraceEvent &event) {
+    printf(
+        "step %lu value x%04hx\n",
+        static_cast<unsigned long>(event.step),
+        event.value
+    );
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef REVERSE_CPP
+#define REVERSE_CPP
+
+#include <vector>  // std::vector
+
+#include "globals.hpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Default amount of instructions which can be reversed
+#define UNDO_LOG_DEFAULT_SIZE 65536
+
+// State before an instruction, enough to reverse it
+// Instructions write at most one word
+typedef struct UndoRecord {
+    Registers registers;
+    bool has_write;
+    Word write_addr;
+    Word old_value;
+} UndoRecord;
+
+// Ring buffer of most recent instructions, used by the debugger
+// Oldest instructions are forgotten, so memory is bounded by `records` size
+typedef struct UndoLog {
+    bool is_enabled = false;
+    vector<UndoRecord> records;
+    size_t next;   // Index of next record to write
+    size_t count;  // Amount of records which can be undone
+} UndoLog;
+
+static UndoLog undo_log;
+
+void enable_undo_log(const size_t size);
+void undo_log_access(const Word addr, const MemoryAccess access);
+// `false` if log is empty
+bool undo_instruction(void);
+
+void enable_undo_log(const size_t size) {
+    undo_log.is_enabled = true;
+    undo_log.records.resize(size);
+    undo_log.next = 0;
+    undo_log.count = 0;
+}
+
+// Fetch starts a record, as registers have not yet been modified
+void undo_log_access(const Word addr, const MemoryAccess access) {
+    if (access == MemoryAccess::FETCH) {
+        UndoRecord &record = undo_log.records[undo_log.next];
+        record.registers = machine->registers;
+        record.has_write = false;
+        ++undo_log.next;
+        if (undo_log.next == undo_log.records.size())
+            undo_log.next = 0;
+        if (undo_log.count < undo_log.records.size())
+            ++undo_log.count;
+    } else if (access == MemoryAccess::WRITE) {
+        const size_t size = undo_log.records.size();
+        const size_t last = (undo_log.next + size - 1) % size;
+        UndoRecord &record = undo_log.records[last];
+        record.has_write = true;
+        record.write_addr = addr;
+        record.old_value = machine->memory[addr];
+    }
+}
+
+// Output is not taken back, and input is read again if re-executed
+bool undo_instruction() {
+    if (undo_log.count == 0)
+        return false;
+    const size_t size = undo_log.records.size();
+    undo_log.next = (undo_log.next + size - 1) % size;
+    --undo_log.count;
+
+    const UndoRecord &record = undo_log.records[undo_log.next];
+    if (record.has_write)
+        machine->memory[record.write_addr] = record.old_value;
+    machine->registers = record.registers;
+    if (machine->instruction_count > 0)
+        --machine->instruction_count;
+    return true;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
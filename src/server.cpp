@@ -0,0 +1,433 @@
+#ifndef SERVER_CPP
+#define SERVER_CPP
+
+#include <pthread.h>     // pthread_create, pthread_join
+#include <signal.h>      // signal, SIGPIPE
+#include <sys/socket.h>  // socket, bind, listen, accept
+#include <sys/un.h>      // sockaddr_un
+#include <time.h>        // clock_gettime
+#include <unistd.h>      // read, write, close, unlink, sysconf, usleep
+
+#include <cerrno>   // errno
+#include <cstdio>   // fprintf, snprintf
+#include <cstring>  // strlen, strcpy
+#include <vector>   // std::vector
+
+#include "assemble.cpp"
+#include "diagnostic.cpp"
+#include "error.hpp"
+#include "execute.cpp"
+#include "globals.hpp"
+#include "machine.cpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Runs many small programs without a process per program
+// Each worker thread owns a machine, and accepts connections from the socket
+//
+// Protocol (all integers are little-endian):
+//   Request:
+//     u8   kind                 0 = assembly source, 1 = object file
+//     u32  program length, then program bytes
+//     u32  input length, then input bytes (read by `GETC`/`IN`)
+//     u64  max instructions     0 for server default
+//     u32  max output bytes     0 for server default
+//     u32  max milliseconds     0 for server default
+//   Response:
+//     u32  status               Exit code which `lasim` would return
+//     u8   halted               1 if program reached `HALT`
+//     u64  instruction count
+//     u64  elapsed nanoseconds  Assembling and executing
+//     u32  output length, then output bytes
+//     u32  diagnostics length, then assembler and execution diagnostics text
+// Any amount of requests may be sent on one connection
+// Limits above the server maximum are lowered to it, so no job can occupy a
+//     worker or grow its output indefinitely
+
+#define SERVER_MAX_WORKERS 64
+#define SERVER_BACKLOG 64
+#define SERVER_MAX_PAYLOAD (1 << 20)  // For program or input bytes
+#define SERVER_ACCEPT_RETRY_MICROSECONDS 100000
+
+#define SERVER_DEFAULT_INSTRUCTIONS 10000000
+#define SERVER_MAX_INSTRUCTIONS 1000000000
+#define SERVER_DEFAULT_OUTPUT (64 << 10)
+#define SERVER_MAX_OUTPUT SERVER_MAX_PAYLOAD
+#define SERVER_DEFAULT_MILLISECONDS 1000
+#define SERVER_MAX_MILLISECONDS 10000
+
+enum class JobKind {
+    SOURCE = 0,
+    OBJECT = 1,
+};
+
+// Reused between requests, so buffers stay allocated
+typedef struct Job {
+    // Request
+    JobKind kind;
+    vector<char> program;
+    vector<char> input;
+    Limits limits;
+
+    // Response
+    Error status;
+    bool halted;
+    uint64_t instruction_count;
+    uint64_t elapsed_nanoseconds;
+    vector<char> output;
+    vector<char> diagnostics;
+
+    vector<Diagnostic> messages;  // Collected while loading and executing
+    size_t input_position;
+    vector<char> response;
+} Job;
+
+void serve(const char *const socket_filename, Error &error);
+void *serve_worker(void *listen_fd);
+void handle_connection(const int fd, Job &job);
+
+bool read_job(const int fd, Job &job);
+uint64_t job_limit(uint64_t value, uint64_t fallback, uint64_t maximum);
+void run_job(Job &job);
+void write_job_diagnostics(Job &job, const vector<Diagnostic> &list);
+bool write_job_result(const int fd, Job &job);
+
+int job_input(void *context);
+void job_output(char ch, void *context);
+
+bool read_exact(const int fd, void *const buffer, const size_t length);
+bool write_exact(const int fd, const void *const buffer, const size_t length);
+bool read_u32(const int fd, uint32_t &value);
+bool read_u64(const int fd, uint64_t &value);
+void push_u32(vector<char> &buffer, const uint32_t value);
+void push_u64(vector<char> &buffer, const uint64_t value);
+
+void serve(const char *const socket_filename, Error &error) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_filename) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path is too long: %s\n", socket_filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    strcpy(address.sun_path, socket_filename);
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Failed to create socket\n");
+        SET_ERROR(error, FILE);
+        return;
+    }
+    // Replace stale socket from a previous server
+    unlink(socket_filename);
+    sockaddr *const generic_address = reinterpret_cast<sockaddr *>(&address);
+    if (bind(listen_fd, generic_address, sizeof(address)) < 0 ||
+        listen(listen_fd, SERVER_BACKLOG) < 0) {
+        fprintf(stderr, "Failed to bind socket: %s\n", socket_filename);
+        close(listen_fd);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    // Client disconnecting should not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    long worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (worker_count < 1)
+        worker_count = 1;
+    if (worker_count > SERVER_MAX_WORKERS)
+        worker_count = SERVER_MAX_WORKERS;
+
+    pthread_t workers[SERVER_MAX_WORKERS];
+    // Passed by pointer, lives for duration of all workers
+    int shared_fd = listen_fd;
+    for (long i = 0; i < worker_count; ++i) {
+        if (pthread_create(&workers[i], nullptr, serve_worker, &shared_fd)) {
+            fprintf(stderr, "Failed to create worker thread\n");
+            SET_ERROR(error, EXECUTE);
+            worker_count = i;
+            break;
+        }
+    }
+    fprintf(
+        stderr,
+        "Serving on %s with %ld workers\n",
+        socket_filename,
+        worker_count
+    );
+
+    for (long i = 0; i < worker_count; ++i)
+        pthread_join(workers[i], nullptr);
+    close(listen_fd);
+}
+
+void *serve_worker(void *listen_fd) {
+    const int fd = *static_cast<int *>(listen_fd);
+
+    // Each worker has its own machine, as `machine` is thread-local
+    Machine *const worker_machine = new Machine();
+    machine = worker_machine;
+    Job job;
+
+    while (true) {
+        const int connection_fd = accept(fd, nullptr, nullptr);
+        if (connection_fd < 0) {
+            // Interrupted, or client disconnected before it was accepted
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            // Out of file descriptors or memory, until connections close
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+                errno == ENOMEM) {
+                usleep(SERVER_ACCEPT_RETRY_MICROSECONDS);
+                continue;
+            }
+            // Socket is unusable, so server stops once all workers have
+            fprintf(stderr, "Failed to accept connection\n");
+            break;
+        }
+        handle_connection(connection_fd, job);
+        close(connection_fd);
+    }
+
+    delete worker_machine;
+    return nullptr;
+}
+
+void handle_connection(const int fd, Job &job) {
+    while (read_job(fd, job)) {
+        run_job(job);
+        if (!write_job_result(fd, job))
+            return;
+    }
+}
+
+// Returns `false` on end of connection or malformed request
+bool read_job(const int fd, Job &job) {
+    uint8_t kind;
+    if (!read_exact(fd, &kind, 1))
+        return false;
+    if (kind != static_cast<uint8_t>(JobKind::SOURCE) &&
+        kind != static_cast<uint8_t>(JobKind::OBJECT)) {
+        return false;
+    }
+    job.kind = static_cast<JobKind>(kind);
+
+    uint32_t length;
+    if (!read_u32(fd, length) || length > SERVER_MAX_PAYLOAD)
+        return false;
+    job.program.resize(length);
+    if (!read_exact(fd, job.program.data(), length))
+        return false;
+
+    if (!read_u32(fd, length) || length > SERVER_MAX_PAYLOAD)
+        return false;
+    job.input.resize(length);
+    if (!read_exact(fd, job.input.data(), length))
+        return false;
+
+    uint32_t max_output;
+    uint32_t max_milliseconds;
+    if (!read_u64(fd, job.limits.max_instructions) ||
+        !read_u32(fd, max_output) || !read_u32(fd, max_milliseconds)) {
+        return false;
+    }
+    Limits &limits = job.limits;
+    limits.max_instructions = job_limit(
+        limits.max_instructions,
+        SERVER_DEFAULT_INSTRUCTIONS,
+        SERVER_MAX_INSTRUCTIONS
+    );
+    limits.max_output =
+        job_limit(max_output, SERVER_DEFAULT_OUTPUT, SERVER_MAX_OUTPUT);
+    limits.max_milliseconds = job_limit(
+        max_milliseconds, SERVER_DEFAULT_MILLISECONDS, SERVER_MAX_MILLISECONDS
+    );
+    return true;
+}
+
+// Requested limit, or `fallback` if 0, at most `maximum`
+uint64_t job_limit(uint64_t value, uint64_t fallback, uint64_t maximum) {
+    if (value == 0)
+        value = fallback;
+    return value < maximum ? value : maximum;
+}
+
+void run_job(Job &job) {
+    const uint64_t start_time = monotonic_nanoseconds();
+
+    job.status = Error::OK;
+    job.halted = false;
+    job.instruction_count = 0;
+    job.output.clear();
+    job.diagnostics.clear();
+    job.messages.clear();
+    job.input_position = 0;
+
+    reset_machine(*machine);
+    machine->input = job_input;
+    machine->output = job_output;
+    machine->io_context = &job;
+    machine->limits = job.limits;
+    start_run();
+
+    // Runtime failures are reported to the client, not the server's stderr
+    vector<Diagnostic> *const previous_list = diagnostics.list;
+    diagnostics.list = &job.messages;
+
+    Error &error = job.status;
+    if (job.kind == JobKind::SOURCE) {
+        Assembly assembly;
+        const vector<char> &source = job.program;
+        assemble_buffer(source.data(), source.size(), assembly, error);
+        write_job_diagnostics(job, assembly.diagnostics);
+        if (error == Error::OK) {
+            load_words_to_memory(
+                assembly.words.data(), assembly.words.size(), error
+            );
+        }
+    } else if (job.program.size() % WORD_SIZE != 0) {
+        diagnostic("Object has an odd amount of bytes\n");
+        push_diagnostic(0);
+        SET_ERROR(error, EXECUTE);
+    } else {
+        // Object file is big-endian
+        vector<Word> words;
+        for (size_t i = 0; i + 1 < job.program.size(); i += WORD_SIZE) {
+            const uint8_t high = job.program[i];
+            const uint8_t low = job.program[i + 1];
+            words.push_back(static_cast<Word>(high << 8 | low));
+        }
+        load_words_to_memory(words.data(), words.size(), error);
+    }
+
+    if (error == Error::OK) {
+        machine->registers.program_counter = machine->memory_file_bounds.start;
+
+        bool do_halt = false;
+        while (!do_halt && error == Error::OK) {
+            bool do_breakpoint = false;  // Ignored
+            execute_limited_instructions(do_halt, do_breakpoint, error);
+        }
+        job.halted = do_halt && error == Error::OK;
+        if (job.halted)
+            print_on_new_line();
+    }
+    job.instruction_count = machine->instruction_count;
+
+    diagnostics.list = previous_list;
+    write_job_diagnostics(job, job.messages);
+
+    machine->input = nullptr;
+    machine->output = nullptr;
+    machine->io_context = nullptr;
+
+    job.elapsed_nanoseconds = monotonic_nanoseconds() - start_time;
+}
+
+// Same format as printed by `assemble`
+void write_job_diagnostics(Job &job, const vector<Diagnostic> &list) {
+    char line[MAX_DIAGNOSTIC + 32];
+    for (size_t i = 0; i < list.size(); ++i) {
+        int length = snprintf(line, sizeof(line), "%s\n", list[i].message);
+        if (list[i].line_number > 0) {
+            length += snprintf(
+                line + length,
+                sizeof(line) - length,
+                "\tLine %d\n",
+                list[i].line_number
+            );
+        }
+        job.diagnostics.insert(job.diagnostics.end(), line, line + length);
+    }
+}
+
+bool write_job_result(const int fd, Job &job) {
+    vector<char> &response = job.response;
+    response.clear();
+    push_u32(response, static_cast<uint32_t>(job.status));
+    response.push_back(job.halted ? 1 : 0);
+    push_u64(response, job.instruction_count);
+    push_u64(response, job.elapsed_nanoseconds);
+    push_u32(response, job.output.size());
+    response.insert(response.end(), job.output.begin(), job.output.end());
+    push_u32(response, job.diagnostics.size());
+    response.insert(
+        response.end(), job.diagnostics.begin(), job.diagnostics.end()
+    );
+    return write_exact(fd, response.data(), response.size());
+}
+
+int job_input(void *context) {
+    Job &job = *static_cast<Job *>(context);
+    if (job.input_position >= job.input.size())
+        return EOF;
+    return static_cast<uint8_t>(job.input[job.input_position++]);
+}
+
+void job_output(char ch, void *context) {
+    Job &job = *static_cast<Job *>(context);
+    job.output.push_back(ch);
+}
+
+bool read_exact(const int fd, void *const buffer, const size_t length) {
+    char *const bytes = static_cast<char *>(buffer);
+    size_t total = 0;
+    while (total < length) {
+        const ssize_t count = read(fd, bytes + total, length - total);
+        if (count <= 0)
+            return false;
+        total += count;
+    }
+    return true;
+}
+
+bool write_exact(const int fd, const void *const buffer, const size_t length) {
+    const char *const bytes = static_cast<const char *>(buffer);
+    size_t total = 0;
+    while (total < length) {
+        const ssize_t count = write(fd, bytes + total, length - total);
+        if (count <= 0)
+            return false;
+        total += count;
+    }
+    return true;
+}
+
+bool read_u32(const int fd, uint32_t &value) {
+    uint8_t bytes[4];
+    if (!read_exact(fd, bytes, sizeof(bytes)))
+        return false;
+    value = 0;
+    for (int i = 3; i >= 0; --i)
+        value = value << 8 | bytes[i];
+    return true;
+}
+
+bool read_u64(const int fd, uint64_t &value) {
+    uint8_t bytes[8];
+    if (!read_exact(fd, bytes, sizeof(bytes)))
+        return false;
+    value = 0;
+    for (int i = 7; i >= 0; --i)
+        value = value << 8 | bytes[i];
+    return true;
+}
+
+void push_u32(vector<char> &buffer, const uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        buffer.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+void push_u64(vector<char> &buffer, const uint64_t value) {
+    for (int i = 0; i < 8; ++i)
+        buffer.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
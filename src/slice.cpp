@@ -5,6 +5,9 @@
 #include <cstddef>
 #include <cstdio>
 
+namespace lasim {
+namespace internal {
+
 // Temporary reference to a substring of a line
 // Must be copied if used after line is overwritten
 typedef struct StringSlice {
@@ -65,4 +68,7 @@ void print_string_slice(FILE *const &file, const StringSlice &slice) {
     }
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
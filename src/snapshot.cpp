@@ -0,0 +1,285 @@
+#ifndef SNAPSHOT_CPP
+#define SNAPSHOT_CPP
+
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close, isatty
+
+#include <csignal>  // signal, SIGINT, SIGTERM
+#include <cstdio>   // fprintf, fopen, fwrite
+#include <cstring>  // memcmp, memcpy
+
+#include "error.hpp"
+#include "globals.hpp"
+#include "machine.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+// File format:
+//     Header: `SnapshotHeader`
+//     Each touched page of memory (see `touch_memory`), in order of address,
+//         with a bit set in `page_bits` for each
+//     Most recent PCs (`history_count` words), oldest first
+// A crash dump is a snapshot at the failed instruction
+// Words are in host byte order, so pages can be copied straight from a
+//     mapped file. `byte_order` is checked, so a foreign file is rejected
+// Header is a multiple of 8 bytes, and pages follow it directly
+#define SNAPSHOT_MAGIC "LCSNAPS\x01"
+#define SNAPSHOT_MAGIC_SIZE 8
+#define SNAPSHOT_BYTE_ORDER 0x0102
+
+#define SNAPSHOT_PAGE_SIZE TOUCHED_PAGE_SIZE
+#define SNAPSHOT_PAGE_COUNT TOUCHED_PAGE_COUNT
+
+typedef struct SnapshotHeader {
+    char magic[SNAPSHOT_MAGIC_SIZE];
+    uint64_t page_bits[SNAPSHOT_PAGE_COUNT / 64];
+    uint64_t instruction_count;  // Since program start, for information
+    uint64_t input_count;        // Bytes read by traps, skipped on resume
+    Word general_purpose[GP_REGISTER_COUNT];
+    Word program_counter;
+    Word condition;
+    Word file_start;
+    Word file_end;
+    Word stdout_on_new_line;
+    Word byte_order;
+    Word history_count;
+    Word padding;
+} SnapshotHeader;
+
+typedef struct Snapshot {
+    // `nullptr` if snapshot is not saved
+    const char *save_filename = nullptr;
+    // `nullptr` if crash dump is disabled
+    const char *crash_filename = nullptr;
+    // Of program before this run, when resumed
+    uint64_t resumed_instruction_count = 0;
+    uint64_t resumed_input_count = 0;
+    // Bytes to discard before stdin is next read
+    uint64_t input_to_skip = 0;
+} Snapshot;
+
+static Snapshot snapshot;
+
+void enable_save_snapshot(const char *const filename);
+void enable_crash_dump(const char *const filename);
+// `description` is used in messages
+void save_snapshot(
+    const char *const filename, const char *const description, Error &error
+);
+void save_crash_dump(const char *const filename);
+void load_snapshot(const char *const filename, Error &error);
+void resume_snapshot_input(void);
+void skip_snapshot_input(void);
+
+static void request_interrupt(int signal_number);
+
+// Saved on HALT, on `DEBUG` trap, or once interrupted by SIGINT or SIGTERM
+void enable_save_snapshot(const char *const filename) {
+    snapshot.save_filename = filename;
+    signal(SIGINT, request_interrupt);
+    signal(SIGTERM, request_interrupt);
+    machine->check_interrupts = true;
+}
+
+// Saved if execution fails, other than by a limit
+void enable_crash_dump(const char *const filename) {
+    snapshot.crash_filename = filename;
+}
+
+void save_snapshot(
+    const char *const filename, const char *const description, Error &error
+) {
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+
+    const Word *const memory = machine->memory;
+    size_t page_count = 0;
+    for (size_t i = 0; i < SNAPSHOT_PAGE_COUNT / 64; ++i) {
+        header.page_bits[i] = machine->touched_pages[i];
+        page_count += __builtin_popcountll(header.page_bits[i]);
+    }
+
+    const Registers &registers = machine->registers;
+    header.instruction_count =
+        snapshot.resumed_instruction_count + machine->instruction_count;
+    header.input_count = machine->input_count;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        header.general_purpose[i] = registers.general_purpose[i];
+    header.program_counter = registers.program_counter;
+    header.condition = static_cast<Word>(registers.condition);
+    header.file_start = machine->memory_file_bounds.start;
+    header.file_end = machine->memory_file_bounds.end;
+    header.stdout_on_new_line = machine->stdout_on_new_line;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    Word history[PC_HISTORY_SIZE];
+    header.history_count = static_cast<Word>(get_pc_history(history));
+
+    FILE *const file = fopen(filename, "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open %s file: %s\n", description, filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    bool is_written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t page = 0; page < SNAPSHOT_PAGE_COUNT && is_written; ++page) {
+        if (!(header.page_bits[page / 64] >> (page % 64) & 1))
+            continue;
+        is_written = fwrite(
+                         memory + page * SNAPSHOT_PAGE_SIZE,
+                         WORD_SIZE,
+                         SNAPSHOT_PAGE_SIZE,
+                         file
+                     ) == SNAPSHOT_PAGE_SIZE;
+    }
+    if (is_written) {
+        is_written = fwrite(history, WORD_SIZE, header.history_count, file) ==
+                     header.history_count;
+    }
+    if (fclose(file) != 0)
+        is_written = false;
+    if (!is_written) {
+        fprintf(stderr, "Failed to write %s file: %s\n", description, filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    fprintf(
+        stderr,
+        "Saved %s at 0x%04hx (%zu pages): %s\n",
+        description,
+        registers.program_counter,
+        page_count,
+        filename
+    );
+}
+
+// Replaces all memory and registers
+void load_snapshot(const char *const filename, Error &error) {
+    const int fd = open(filename, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        fprintf(stderr, "Could not open snapshot file: %s\n", filename);
+        if (fd >= 0)
+            close(fd);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    const size_t size = status.st_size;
+    void *const data =
+        size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                 : MAP_FAILED;
+    close(fd);
+
+    const SnapshotHeader *const header =
+        static_cast<const SnapshotHeader *>(data);
+    bool is_valid =
+        data != MAP_FAILED && size >= sizeof(SnapshotHeader) &&
+        !memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) &&
+        header->byte_order == SNAPSHOT_BYTE_ORDER &&
+        header->condition <= 0b111 && header->history_count <= PC_HISTORY_SIZE;
+    if (is_valid) {
+        size_t page_count = 0;
+        for (size_t i = 0; i < SNAPSHOT_PAGE_COUNT / 64; ++i)
+            page_count += __builtin_popcountll(header->page_bits[i]);
+        const size_t page_bytes = SNAPSHOT_PAGE_SIZE * WORD_SIZE;
+        is_valid = size == sizeof(SnapshotHeader) + page_count * page_bytes +
+                               header->history_count * WORD_SIZE;
+    }
+    if (!is_valid) {
+        fprintf(stderr, "Invalid snapshot file: %s\n", filename);
+        if (data != MAP_FAILED)
+            munmap(data, size);
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    const Word *page_data = reinterpret_cast<const Word *>(header + 1);
+    for (size_t i = 0; i < SNAPSHOT_PAGE_COUNT / 64; ++i)
+        machine->touched_pages[i] = header->page_bits[i];
+    for (size_t page = 0; page < SNAPSHOT_PAGE_COUNT; ++page) {
+        Word *const words = machine->memory + page * SNAPSHOT_PAGE_SIZE;
+        if (header->page_bits[page / 64] >> (page % 64) & 1) {
+            memcpy(words, page_data, SNAPSHOT_PAGE_SIZE * WORD_SIZE);
+            page_data += SNAPSHOT_PAGE_SIZE;
+        } else {
+            memset(words, 0, SNAPSHOT_PAGE_SIZE * WORD_SIZE);
+        }
+    }
+
+    // Before index 0, as run starts with no instructions
+    const size_t history_count = header->history_count;
+    for (size_t i = 0; i < history_count; ++i) {
+        const size_t index = PC_HISTORY_SIZE - history_count + i;
+        machine->pc_history[index] = page_data[i];
+    }
+    machine->pc_history_resumed = history_count;
+
+    Registers &registers = machine->registers;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        registers.general_purpose[i] = header->general_purpose[i];
+    registers.program_counter = header->program_counter;
+    registers.condition = static_cast<ConditionCode>(header->condition);
+    machine->memory_file_bounds.start = header->file_start;
+    machine->memory_file_bounds.end = header->file_end;
+    machine->stdout_on_new_line = header->stdout_on_new_line != 0;
+    snapshot.resumed_instruction_count = header->instruction_count;
+    snapshot.resumed_input_count = header->input_count;
+    munmap(data, size);
+}
+
+// PC is set to the failed instruction, which is last in the PC history
+// Failure to save is only reported, as execution already failed
+void save_crash_dump(const char *const filename) {
+    Word history[PC_HISTORY_SIZE];
+    const size_t history_count = get_pc_history(history);
+    const Word pc = machine->registers.program_counter;
+    if (history_count > 0)
+        machine->registers.program_counter = history[history_count - 1];
+
+    Error error = Error::OK;
+    save_snapshot(filename, "crash dump", error);
+    if (error == Error::OK) {
+        fprintf(
+            stderr,
+            "Inspect with `lasim --snapshot %s -d`\n",
+            filename
+        );
+    }
+    machine->registers.program_counter = pc;
+}
+
+// Called once run has started, as input count is reset
+// Input which was already read is skipped, if the same input is given again
+// Input from a terminal is not skipped
+void resume_snapshot_input() {
+    machine->input_count = snapshot.resumed_input_count;
+    if (machine->input == nullptr && !isatty(STDIN_FILENO))
+        snapshot.input_to_skip = snapshot.resumed_input_count;
+}
+
+// Deferred until program reads, so a program which reads no more input does
+//     not wait for it
+void skip_snapshot_input() {
+    for (; snapshot.input_to_skip > 0; --snapshot.input_to_skip) {
+        if (getchar() == EOF)
+            break;
+    }
+    snapshot.input_to_skip = 0;
+}
+
+// Checked with limits, so execution stops within `LIMIT_CHECK_INTERVAL`
+//     instructions
+static void request_interrupt(int signal_number) {
+    (void)signal_number;
+    interrupt_requested = 1;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
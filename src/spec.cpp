@@ -0,0 +1,66 @@
+#ifndef SPEC_CPP
+#define SPEC_CPP
+
+#include <cstddef>  // size_t
+#include <cstring>  // strlen, strncmp
+
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+// Parsing of option values with comma-separated `KEY=VALUE` fields, such as
+//     `size=256,ways=2`
+// After each field, `spec` points to the following ',' or '\0'
+
+bool parse_spec_field(
+    const char *&spec, const char *const name, const char *&value
+);
+bool parse_spec_number(
+    const char *const value, const char *const end, size_t &number
+);
+bool spec_value_equals(
+    const char *const value, const char *const end, const char *const literal
+);
+
+// If `spec` starts with `NAME=`, move `spec` to end of the value
+bool parse_spec_field(
+    const char *&spec, const char *const name, const char *&value
+) {
+    const size_t length = strlen(name);
+    if (strncmp(spec, name, length) || spec[length] != '=')
+        return false;
+    value = spec + length + 1;
+    spec = value;
+    while (*spec != '\0' && *spec != ',')
+        ++spec;
+    return true;
+}
+
+// Decimal value from `value` to `end`
+// Fails for large values (around `MEMORY_SIZE * 10`), instead of overflowing
+bool parse_spec_number(
+    const char *const value, const char *const end, size_t &number
+) {
+    if (value == end)
+        return false;
+    number = 0;
+    for (const char *ch = value; ch < end; ++ch) {
+        if (*ch < '0' || *ch > '9' || number > MEMORY_SIZE)
+            return false;
+        number = number * 10 + (*ch - '0');
+    }
+    return true;
+}
+
+bool spec_value_equals(
+    const char *const value, const char *const end, const char *const literal
+) {
+    const size_t length = end - value;
+    return length == strlen(literal) && !strncmp(value, literal, length);
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef SYMBOLS_CPP
+#define SYMBOLS_CPP
+
+#include <cctype>   // tolower
+#include <cstdio>   // fopen, fread, fwrite
+#include <cstring>  // strcpy, memcmp
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "slice.cpp"
+#include "token.cpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// Sidecar file, written by the assembler and read instead of assembling
+// File format:
+//     `SYMBOLS_MAGIC` (8 bytes, including version)
+//     Varints (little-endian base 128):
+//         Source filename length, then its bytes
+//         Origin
+//         Label count, then for each label, in order of address:
+//             Address - previous address (from origin), then name length,
+//                 then its bytes
+//         Word count, then for each word from origin:
+//             Line number - previous line number, as zigzag, shifted left
+//                 by 1, with bit 0 set if the word is an instruction
+// Lines mostly increase by 0 or 1, so a word usually takes 1 byte
+// Source text is not included, so there is no annotated listing
+#define SYMBOLS_MAGIC "LCSYMBL\x02"
+#define SYMBOLS_MAGIC_SIZE 8
+
+// Label at an address in memory
+typedef struct Symbol {
+    LabelString name;
+    Word address;
+} Symbol;
+
+// Source information of the program in memory, for reports and the debugger
+// Only available if program was assembled in the same process, or read from
+//     a symbols file
+typedef struct SymbolTable {
+    bool is_loaded = false;
+    // As given to assembler, or empty
+    char filename[FILENAME_MAX];
+    // In order of address
+    vector<Symbol> labels;
+    // Indexes of `labels`, in order of lowercase name
+    vector<size_t> name_order;
+    // Source line of each word, from `origin`
+    Word origin;
+    vector<int> line_numbers;
+    // Whether each word, from `origin`, is an instruction rather than data
+    vector<bool> is_instruction;
+    // Source text, and offset of start of each line (from line 1)
+    vector<char> source;
+    vector<size_t> line_offsets;
+} SymbolTable;
+
+static SymbolTable symbols;
+
+// `source` is taken, and left empty
+void load_symbols(
+    const char *const filename,
+    const Word origin,
+    const vector<LabelDefinition> &labels,
+    const vector<int> &line_numbers,
+    const vector<bool> &is_instruction,
+    vector<char> &source
+);
+void write_symbols_file(const char *const filename, Error &error);
+// Replaces loaded symbols, with one read
+void read_symbols_file(const char *const filename, Error &error);
+
+// Nearest label at or before `address`, or `nullptr`
+const Symbol *find_symbol_before(const Word address);
+// Label with `name` (case-insensitive), or `nullptr`
+const Symbol *find_symbol(const StringSlice name);
+// 0 if unknown
+int find_line_number(const Word address);
+size_t source_line_count(void);
+// Excludes line ending
+StringSlice source_line(const int line_number);
+
+static void sort_symbol_names(void);
+static int compare_symbol_name(
+    const char *const name, const StringSlice other
+);
+static void put_symbols_varint(vector<uint8_t> &buffer, uint32_t value);
+static bool take_symbols_varint(
+    const vector<uint8_t> &buffer, size_t &offset, uint32_t &value
+);
+
+void load_symbols(
+    const char *const filename,
+    const Word origin,
+    const vector<LabelDefinition> &labels,
+    const vector<int> &line_numbers,
+    const vector<bool> &is_instruction,
+    vector<char> &source
+) {
+    symbols.is_loaded = true;
+    strcpy(symbols.filename, filename);
+    symbols.origin = origin;
+
+    // Label indexes are word indexes, and `words[0]` is origin
+    symbols.labels.clear();
+    for (size_t i = 0; i < labels.size(); ++i) {
+        symbols.labels.push_back({});
+        Symbol &symbol = symbols.labels.back();
+        strcpy(symbol.name, labels[i].name);
+        symbol.address = origin + labels[i].index - 1;
+    }
+    sort_symbol_names();
+
+    symbols.line_numbers.clear();
+    symbols.is_instruction.clear();
+    for (size_t i = 1; i < line_numbers.size(); ++i) {
+        symbols.line_numbers.push_back(line_numbers[i]);
+        symbols.is_instruction.push_back(is_instruction[i]);
+    }
+
+    symbols.source.clear();
+    symbols.source.swap(source);
+    symbols.line_offsets.clear();
+    if (symbols.source.size() > 0)
+        symbols.line_offsets.push_back(0);
+    for (size_t i = 0; i + 1 < symbols.source.size(); ++i) {
+        if (symbols.source[i] == '\n')
+            symbols.line_offsets.push_back(i + 1);
+    }
+}
+
+// Binary search, for last label which is not after `address`
+// Of labels at the same address, the last is found
+const Symbol *find_symbol_before(const Word address) {
+    size_t low = 0;
+    size_t high = symbols.labels.size();
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (symbols.labels[middle].address > address)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return low > 0 ? &symbols.labels[low - 1] : nullptr;
+}
+
+// Binary search of `name_order`
+const Symbol *find_symbol(const StringSlice name) {
+    size_t low = 0;
+    size_t high = symbols.name_order.size();
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const Symbol &symbol = symbols.labels[symbols.name_order[middle]];
+        const int order = compare_symbol_name(symbol.name, name);
+        if (order == 0)
+            return &symbol;
+        if (order > 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return nullptr;
+}
+
+int find_line_number(const Word address) {
+    if (address < symbols.origin)
+        return 0;
+    const size_t index = address - symbols.origin;
+    if (index >= symbols.line_numbers.size())
+        return 0;
+    return symbols.line_numbers[index];
+}
+
+size_t source_line_count() {
+    return symbols.line_offsets.size();
+}
+
+StringSlice source_line(const int line_number) {
+    const vector<size_t> &offsets = symbols.line_offsets;
+    if (line_number < 1 || static_cast<size_t>(line_number) > offsets.size())
+        return {nullptr, 0};
+    const size_t start = offsets[line_number - 1];
+    size_t end = start;
+    while (end < symbols.source.size() && symbols.source[end] != '\n')
+        ++end;
+    if (end > start && symbols.source[end - 1] == '\r')
+        --end;
+    return {symbols.source.data() + start, end - start};
+}
+
+void write_symbols_file(const char *const filename, Error &error) {
+    vector<uint8_t> buffer(
+        SYMBOLS_MAGIC, SYMBOLS_MAGIC + SYMBOLS_MAGIC_SIZE
+    );
+
+    const size_t filename_length = strlen(symbols.filename);
+    put_symbols_varint(buffer, filename_length);
+    buffer.insert(
+        buffer.end(), symbols.filename, symbols.filename + filename_length
+    );
+
+    put_symbols_varint(buffer, symbols.origin);
+    put_symbols_varint(buffer, symbols.labels.size());
+    Word address = symbols.origin;
+    for (size_t i = 0; i < symbols.labels.size(); ++i) {
+        const Symbol &symbol = symbols.labels[i];
+        put_symbols_varint(buffer, symbol.address - address);
+        address = symbol.address;
+        const size_t length = strlen(symbol.name);
+        put_symbols_varint(buffer, length);
+        buffer.insert(buffer.end(), symbol.name, symbol.name + length);
+    }
+
+    put_symbols_varint(buffer, symbols.line_numbers.size());
+    int line = 0;
+    for (size_t i = 0; i < symbols.line_numbers.size(); ++i) {
+        // Zigzag, so a decrease is also small
+        const int delta = symbols.line_numbers[i] - line;
+        const uint32_t sign = static_cast<uint32_t>(delta >> 31);
+        const uint32_t zigzag = static_cast<uint32_t>(delta) << 1 ^ sign;
+        put_symbols_varint(buffer, zigzag << 1 | symbols.is_instruction[i]);
+        line = symbols.line_numbers[i];
+    }
+
+    FILE *const file = fopen(filename, "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open symbols file: %s\n", filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    const bool is_written =
+        fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    if (fclose(file) != 0 || !is_written) {
+        fprintf(stderr, "Failed to write symbols file: %s\n", filename);
+        SET_ERROR(error, FILE);
+    }
+}
+
+void read_symbols_file(const char *const filename, Error &error) {
+    FILE *const file = fopen(filename, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not open symbols file: %s\n", filename);
+        SET_ERROR(error, FILE);
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    vector<uint8_t> buffer(size > 0 ? size : 0);
+    const bool is_read =
+        size > 0 && fread(buffer.data(), 1, size, file) == buffer.size();
+    fclose(file);
+
+    // Each value is checked, so a malformed file is rejected before use
+    size_t offset = SYMBOLS_MAGIC_SIZE;
+    uint32_t value;
+    bool is_valid = is_read && buffer.size() >= SYMBOLS_MAGIC_SIZE &&
+                    !memcmp(buffer.data(), SYMBOLS_MAGIC, SYMBOLS_MAGIC_SIZE);
+
+    uint32_t filename_length = 0;
+    is_valid = is_valid &&
+               take_symbols_varint(buffer, offset, filename_length) &&
+               filename_length < FILENAME_MAX &&
+               filename_length <= buffer.size() - offset;
+    if (is_valid) {
+        memcpy(symbols.filename, buffer.data() + offset, filename_length);
+        symbols.filename[filename_length] = '\0';
+        offset += filename_length;
+    }
+
+    uint32_t origin = 0;
+    uint32_t label_count = 0;
+    is_valid = is_valid && take_symbols_varint(buffer, offset, origin) &&
+               origin < MEMORY_SIZE &&
+               take_symbols_varint(buffer, offset, label_count) &&
+               label_count <= MEMORY_SIZE;
+    symbols.origin = static_cast<Word>(origin);
+    symbols.labels.clear();
+    uint32_t address = origin;
+    for (size_t i = 0; i < label_count && is_valid; ++i) {
+        uint32_t length;
+        is_valid = take_symbols_varint(buffer, offset, value) &&
+                   (address += value) < MEMORY_SIZE &&
+                   take_symbols_varint(buffer, offset, length) &&
+                   length > 0 && length < MAX_LABEL &&
+                   length <= buffer.size() - offset;
+        if (!is_valid)
+            break;
+        symbols.labels.push_back({});
+        Symbol &symbol = symbols.labels.back();
+        memcpy(symbol.name, buffer.data() + offset, length);
+        symbol.name[length] = '\0';
+        symbol.address = static_cast<Word>(address);
+        offset += length;
+    }
+
+    uint32_t word_count = 0;
+    is_valid = is_valid && take_symbols_varint(buffer, offset, word_count) &&
+               word_count <= MEMORY_SIZE - origin;
+    symbols.line_numbers.clear();
+    symbols.is_instruction.clear();
+    uint32_t line = 0;
+    for (size_t i = 0; i < word_count && is_valid; ++i) {
+        is_valid = take_symbols_varint(buffer, offset, value);
+        const uint32_t zigzag = value >> 1;
+        line += zigzag >> 1 ^ -(zigzag & 1);
+        symbols.line_numbers.push_back(static_cast<int>(line));
+        symbols.is_instruction.push_back(value & 1);
+    }
+
+    if (!is_valid || offset != buffer.size()) {
+        fprintf(stderr, "Invalid symbols file: %s\n", filename);
+        symbols.is_loaded = false;
+        symbols.labels.clear();
+        symbols.line_numbers.clear();
+        symbols.is_instruction.clear();
+        SET_ERROR(error, FILE);
+        return;
+    }
+    symbols.is_loaded = true;
+    symbols.source.clear();
+    symbols.line_offsets.clear();
+    sort_symbol_names();
+}
+
+// Insertion sort, as labels are few
+static void sort_symbol_names() {
+    vector<size_t> &order = symbols.name_order;
+    order.clear();
+    for (size_t i = 0; i < symbols.labels.size(); ++i) {
+        const LabelString &name = symbols.labels[i].name;
+        const StringSlice slice = {name, strlen(name)};
+        size_t j = order.size();
+        order.push_back(i);
+        while (j > 0 &&
+               compare_symbol_name(symbols.labels[order[j - 1]].name, slice) >
+                   0) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+}
+
+// Case-insensitive, like `string_equals_slice`
+static int compare_symbol_name(
+    const char *const name, const StringSlice other
+) {
+    for (size_t i = 0; i < other.length; ++i) {
+        const int a = tolower(name[i]);
+        const int b = tolower(other.pointer[i]);
+        if (a != b)
+            return a - b;  // Includes end of `name`
+    }
+    return name[other.length] != '\0' ? 1 : 0;
+}
+
+static void put_symbols_varint(vector<uint8_t> &buffer, uint32_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+// `false` if truncated or too large
+static bool take_symbols_varint(
+    const vector<uint8_t> &buffer, size_t &offset, uint32_t &value
+) {
+    value = 0;
+    for (size_t shift = 0; shift < 32; shift += 7) {
+        if (offset >= buffer.size())
+            return false;
+        const uint8_t byte = buffer[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
@@ -5,10 +5,14 @@
 #include <cstdio>   // FILE, fprintf, etc
 #include <cstring>  // strcmp, strncmp
 
+#include "diagnostic.cpp"
 #include "error.hpp"
 #include "slice.cpp"
 #include "types.hpp"
 
+namespace lasim {
+namespace internal {
+
 #define MAX_LABEL 32  // Includes '\0'
 
 #define RETURN_IF_FAILED(_failed) \
@@ -145,6 +149,8 @@ void take_directive(const char *&line, Token &token, bool &failed);
 void take_register(const char *&line, Token &token);
 void take_integer_token(const char *&line, Token &token, bool &failed);
 int take_integer(const char *&line, InitialSignWord &number);
+void take_whitespace(const char *&line);
+bool take_keyword(const char *&line, const char *const keyword);
 int take_integer_hex(const char *&line, InitialSignWord &number);
 int take_integer_decimal(const char *&line, InitialSignWord &number);
 int8_t parse_hex_digit(const char ch);
@@ -233,9 +239,9 @@ void take_next_token(const char *&line, Token &token, bool &failed) {
     if (!instruction_from_string_slice(token, identifier)) {
         // Label
         if (identifier.length >= MAX_LABEL) {
-            fprintf(stderr, "Label is over %d characters: `", MAX_LABEL);
-            print_string_slice(stderr, identifier);
-            fprintf(stderr, "`\n");
+            diagnostic("Label is over %d characters: `", MAX_LABEL);
+            diagnostic_string_slice(identifier);
+            diagnostic("`\n");
             failed = true;
             return;
         }
@@ -254,7 +260,7 @@ void take_literal_string(const char *&line, Token &token, bool &failed) {
     for (; line[0] != '"'; ++line) {
         // String cannot be multi-line, or unclosed within a file
         if (line[0] == '\n' || line[0] == '\0') {
-            fprintf(stderr, "Unterminated string literal\n");
+            diagnostic("Unterminated string literal\n");
             failed = true;
             return;
         }
@@ -279,9 +285,9 @@ void take_directive(const char *&line, Token &token, bool &failed) {
 
     // Sets kind and value
     if (!directive_from_string(token, directive)) {
-        fprintf(stderr, "Invalid directive `.");
-        print_string_slice(stderr, directive);
-        fprintf(stderr, "`\n");
+        diagnostic("Invalid directive `.");
+        diagnostic_string_slice(directive);
+        diagnostic("`\n");
         failed = true;
     }
 }
@@ -357,7 +363,7 @@ int take_integer_hex(const char *&line, InitialSignWord &integer) {
         // Leading zeros have already been skipped
         // Ignore sign
         if (i >= 4) {
-            fprintf(stderr, "Integer literal is too large for a word\n");
+            diagnostic("Integer literal is too large for a word\n");
             return -1;
         }
         number <<= 4;
@@ -413,7 +419,7 @@ int take_integer_decimal(const char *&line, InitialSignWord &integer) {
             break;
         }
         if (!append_decimal_digit_checked(number, ch - '0', is_signed)) {
-            fprintf(stderr, "Integer literal is too large for a word\n");
+            diagnostic("Integer literal is too large for a word\n");
             return -1;
         }
         ++line;
@@ -436,6 +442,26 @@ int take_integer(const char *&line, InitialSignWord &integer) {
     return 0;
 }
 
+void take_whitespace(const char *&line) {
+    // Ignore leading spaces
+    while (isspace(line[0]))
+        ++line;
+}
+
+// Case-insensitive whole word
+// `line` is only moved if it matches
+bool take_keyword(const char *&line, const char *const keyword) {
+    const char *word = line;
+    take_whitespace(word);
+    StringSlice slice = {word, 0};
+    while (word[slice.length] != '\0' && !isspace(word[slice.length]))
+        ++slice.length;
+    if (!string_equals_slice(keyword, slice))
+        return false;
+    line = word + slice.length;
+    return true;
+}
+
 void take_integer_token(const char *&line, Token &token, bool &failed) {
     const char *const line_start = line;
     int result = take_integer(line, token.value.integer);
@@ -486,8 +512,8 @@ bool is_char_valid_identifier_start(const char ch) {
 }
 
 void print_invalid_token(const char *const &line) {
-    fprintf(stderr, "Invalid token: `");
-    fprintf(stderr, "%c", line[0]);
+    diagnostic("Invalid token: `");
+    diagnostic("%c", line[0]);
     // Print rest of instruction/label/integer if not starting with punctuation
     if (isalnum(line[0])) {
         for (size_t i = 1;; ++i) {
@@ -495,10 +521,10 @@ void print_invalid_token(const char *const &line) {
             // Only these symbols can terminate a label
             if (isspace(ch) || ch == ',' || ch == ':')
                 break;
-            fprintf(stderr, "%c", ch);
+            diagnostic("%c", ch);
         }
     }
-    fprintf(stderr, "`\n");
+    diagnostic("`\n");
 }
 
 static const char *directive_to_string(const Directive directive) {
@@ -611,4 +637,7 @@ void _print_token(const Token &token) {
     }
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
@@ -0,0 +1,353 @@
+#ifndef TRACE_CPP
+#define TRACE_CPP
+
+#include <cstdio>   // fprintf, fopen, fwrite
+#include <cstring>  // memcpy
+#include <vector>   // std::vector
+
+#include "error.hpp"
+#include "globals.hpp"
+#include "types.hpp"
+
+namespace lasim {
+namespace internal {
+
+using std::vector;
+
+// File format:
+//     Header: `TRACE_MAGIC` (8 bytes, including version)
+//     One record per executed instruction, in order:
+//         Flags byte:
+//             Bit 0: `TRACE_PC`, PC is not previous PC + 1
+//             Bit 1: `TRACE_INSTR`, instruction differs from last at this PC
+//             Bit 2: `TRACE_REGISTER`, a GP register was changed
+//             Bit 3: `TRACE_MEMORY`, a word was written
+//             Bits 4-6: Condition code (NZP) after instruction
+//         If `TRACE_PC`: PC - (previous PC + 1), as zigzag varint
+//         If `TRACE_INSTR`: Instruction word, as varint
+//         If `TRACE_REGISTER`, for each changed register:
+//             Register byte: Bits 0-2 are the register, bit 3 is set if
+//                 another register follows
+//             New value - old value, as zigzag varint
+//         If `TRACE_MEMORY`:
+//             Address - previous written address, as zigzag varint
+//             Value written, as varint
+// Varints are little-endian base 128, so a word takes 1-3 bytes
+// Decoder state starts with all registers, PC, and addresses as 0, and no
+//     known instructions
+// A typical sequential instruction takes 2-3 bytes
+#define TRACE_MAGIC "LCTRACE\x01"
+#define TRACE_MAGIC_SIZE 8
+
+#define TRACE_PC (1 << 0)
+#define TRACE_INSTR (1 << 1)
+#define TRACE_REGISTER (1 << 2)
+#define TRACE_MEMORY (1 << 3)
+#define TRACE_CONDITION_SHIFT 4
+
+#define TRACE_REGISTER_MORE (1 << 3)
+
+// Records are encoded directly into the buffer, which is written once full
+#define TRACE_BUFFER_SIZE (1 << 20)
+// Flags, PC, instruction, 8 registers, address, value
+#define TRACE_RECORD_MAX (1 + 3 + 3 + 8 * 4 + 3 + 3)
+
+// No instruction has been recorded at the address
+#define TRACE_UNKNOWN_INSTR 0x10000
+
+typedef struct Trace {
+    bool is_enabled = false;
+    FILE *file;  // Opened when enabled, so errors are reported early
+    vector<uint8_t> buffer;
+    size_t buffer_length;
+    bool has_failed;  // Write error, reported once the program ends
+
+    // Encoder state, mirroring the decoder
+    Word pc;
+    Word registers[GP_REGISTER_COUNT];
+    Word write_addr;
+    // Last instruction recorded at each address, or `TRACE_UNKNOWN_INSTR`
+    vector<uint32_t> instructions;
+
+    // Write by current instruction, if any
+    bool has_write;
+    Word pending_write_addr;
+
+    uint64_t record_count;
+    uint64_t byte_count;
+} Trace;
+
+static Trace trace;
+
+// State of reading a trace, starting after the header
+// Registers, condition, and written word are as of the last decoded record
+typedef struct TraceDecoder {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+
+    Word pc;
+    Word registers[GP_REGISTER_COUNT];
+    ConditionCode condition;
+    Word write_addr;
+
+    // Of last decoded record
+    uint8_t changed_registers;  // Bit per register
+    bool has_write;
+    Word write_value;
+} TraceDecoder;
+
+void enable_trace(const char *const filename, Error &error);
+void trace_access(const Word addr, const MemoryAccess access);
+void trace_instruction(const Word pc, const Word instr);
+void print_trace(FILE *const file);
+// Decoder state is kept, so decoding can resume at a record boundary
+void start_trace_decoder(
+    TraceDecoder &decoder, const uint8_t *const data, const size_t size
+);
+// `false` if no records remain, or with `is_invalid` if record is malformed
+bool decode_trace_record(TraceDecoder &decoder, bool &is_invalid);
+
+static void flush_trace(void);
+static uint8_t *put_varint(uint8_t *out, Word value);
+static Word zigzag_encode(const int delta);
+static bool take_trace_record(TraceDecoder &decoder);
+static bool take_varint(TraceDecoder &decoder, Word &value);
+static Word zigzag_decode(const Word value);
+
+void enable_trace(const char *const filename, Error &error) {
+    trace.file = fopen(filename, "wb");
+    if (trace.file == nullptr) {
+        fprintf(
+            stderr, "Failed to open trace file for writing: %s\n", filename
+        );
+        SET_ERROR(error, FILE);
+        return;
+    }
+
+    trace.is_enabled = true;
+    trace.buffer.resize(TRACE_BUFFER_SIZE);
+    memcpy(trace.buffer.data(), TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    trace.buffer_length = TRACE_MAGIC_SIZE;
+    trace.has_failed = false;
+    trace.pc = 0;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        trace.registers[i] = 0;
+    trace.write_addr = 0;
+    trace.instructions.assign(MEMORY_SIZE, TRACE_UNKNOWN_INSTR);
+    trace.has_write = false;
+    trace.record_count = 0;
+    trace.byte_count = 0;
+}
+
+// Value is read once the instruction has executed
+void trace_access(const Word addr, const MemoryAccess access) {
+    if (access != MemoryAccess::WRITE)
+        return;
+    trace.has_write = true;
+    trace.pending_write_addr = addr;
+}
+
+// Called after `instr` at `pc` executed
+void trace_instruction(const Word pc, const Word instr) {
+    if (trace.buffer_length > TRACE_BUFFER_SIZE - TRACE_RECORD_MAX)
+        flush_trace();
+
+    uint8_t *const record = trace.buffer.data() + trace.buffer_length;
+    uint8_t *out = record + 1;  // After flags
+    uint8_t flags = static_cast<uint8_t>(machine->registers.condition)
+                    << TRACE_CONDITION_SHIFT;
+
+    const Word expected_pc = static_cast<Word>(trace.pc + 1);
+    if (pc != expected_pc) {
+        flags |= TRACE_PC;
+        out = put_varint(out, zigzag_encode(pc - expected_pc));
+    }
+    trace.pc = pc;
+
+    if (trace.instructions[pc] != instr) {
+        flags |= TRACE_INSTR;
+        out = put_varint(out, instr);
+        trace.instructions[pc] = instr;
+    }
+
+    // Usually none or one changed
+    uint8_t *last_register = nullptr;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i) {
+        const Word value = machine->registers.general_purpose[i];
+        if (value == trace.registers[i])
+            continue;
+        if (last_register != nullptr)
+            *last_register |= TRACE_REGISTER_MORE;
+        last_register = out;
+        *out++ = static_cast<uint8_t>(i);
+        out = put_varint(out, zigzag_encode(value - trace.registers[i]));
+        trace.registers[i] = value;
+    }
+    if (last_register != nullptr)
+        flags |= TRACE_REGISTER;
+
+    if (trace.has_write) {
+        const Word addr = trace.pending_write_addr;
+        flags |= TRACE_MEMORY;
+        out = put_varint(out, zigzag_encode(addr - trace.write_addr));
+        out = put_varint(out, machine->memory[addr]);
+        trace.write_addr = addr;
+        trace.has_write = false;
+    }
+
+    *record = flags;
+    trace.buffer_length = out - trace.buffer.data();
+    ++trace.record_count;
+}
+
+// Write remaining records, and summary
+void print_trace(FILE *const file) {
+    flush_trace();
+    if (fclose(trace.file) != 0)
+        trace.has_failed = true;
+    if (trace.has_failed) {
+        fprintf(file, "\nFailed to write trace file\n");
+        return;
+    }
+
+    fprintf(
+        file,
+        "\nTrace: %lu instructions, %lu bytes",
+        static_cast<unsigned long>(trace.record_count),
+        static_cast<unsigned long>(trace.byte_count)
+    );
+    if (trace.record_count > 0) {
+        fprintf(
+            file,
+            " (%.2f bytes per instruction)",
+            static_cast<double>(trace.byte_count - TRACE_MAGIC_SIZE) /
+                trace.record_count
+        );
+    }
+    fprintf(file, "\n");
+}
+
+static void flush_trace() {
+    const size_t length = trace.buffer_length;
+    if (fwrite(trace.buffer.data(), 1, length, trace.file) != length)
+        trace.has_failed = true;
+    trace.byte_count += length;
+    trace.buffer_length = 0;
+}
+
+void start_trace_decoder(
+    TraceDecoder &decoder, const uint8_t *const data, const size_t size
+) {
+    decoder.data = data;
+    decoder.size = size;
+    decoder.offset = 0;
+    decoder.pc = 0;
+    for (size_t i = 0; i < GP_REGISTER_COUNT; ++i)
+        decoder.registers[i] = 0;
+    decoder.condition = CONDITION_DEFAULT;
+    decoder.write_addr = 0;
+    decoder.changed_registers = 0;
+    decoder.has_write = false;
+}
+
+bool decode_trace_record(TraceDecoder &decoder, bool &is_invalid) {
+    if (decoder.offset >= decoder.size)
+        return false;
+    if (!take_trace_record(decoder)) {
+        is_invalid = true;
+        return false;
+    }
+    return true;
+}
+
+// Returns end of written bytes
+static uint8_t *put_varint(uint8_t *out, Word value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+// Small negative and positive differences both become small values
+// Difference wraps to 16 bits, like the words themselves
+static Word zigzag_encode(const int delta) {
+    // Shifted as unsigned, as shifting a negative value left is undefined
+    const Word bits = static_cast<Word>(delta);
+    return static_cast<Word>(bits << 1 ^ -(bits >> 15));
+}
+
+// `false` if malformed
+// Instruction words are skipped, as they are only needed with the whole trace
+static bool take_trace_record(TraceDecoder &decoder) {
+    const uint8_t flags = decoder.data[decoder.offset++];
+    Word value;
+
+    Word pc = static_cast<Word>(decoder.pc + 1);
+    if (flags & TRACE_PC) {
+        if (!take_varint(decoder, value))
+            return false;
+        pc += zigzag_decode(value);
+    }
+    decoder.pc = pc;
+
+    if (flags & TRACE_INSTR) {
+        if (!take_varint(decoder, value))
+            return false;
+    }
+
+    decoder.changed_registers = 0;
+    if (flags & TRACE_REGISTER) {
+        uint8_t reg_byte;
+        do {
+            if (decoder.offset >= decoder.size)
+                return false;
+            reg_byte = decoder.data[decoder.offset++];
+            if (!take_varint(decoder, value))
+                return false;
+            const size_t reg = reg_byte & 0b111;
+            decoder.registers[reg] += zigzag_decode(value);
+            decoder.changed_registers |= 1 << reg;
+        } while (reg_byte & TRACE_REGISTER_MORE);
+    }
+
+    decoder.has_write = (flags & TRACE_MEMORY) != 0;
+    if (decoder.has_write) {
+        if (!take_varint(decoder, value))
+            return false;
+        decoder.write_addr += zigzag_decode(value);
+        if (!take_varint(decoder, decoder.write_value))
+            return false;
+    }
+
+    decoder.condition =
+        static_cast<ConditionCode>(flags >> TRACE_CONDITION_SHIFT & 0b111);
+    return true;
+}
+
+// `false` if truncated or too large for a word
+static bool take_varint(TraceDecoder &decoder, Word &value) {
+    uint32_t result = 0;
+    for (size_t shift = 0; shift < 21; shift += 7) {
+        if (decoder.offset >= decoder.size)
+            return false;
+        const uint8_t byte = decoder.data[decoder.offset++];
+        result |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = static_cast<Word>(result);
+            return result <= WORD_MAX_UNSIGNED;
+        }
+    }
+    return false;
+}
+
+static Word zigzag_decode(const Word value) {
+    return static_cast<Word>(value >> 1 ^ -(value & 1));
+}
+
+}  // namespace internal
+}  // namespace lasim
+
+#endif
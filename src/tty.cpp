@@ -4,6 +4,9 @@
 #include <termios.h>  // termios, etc
 #include <unistd.h>   // STDIN_FILENO
 
+namespace lasim {
+namespace internal {
+
 static struct termios stdin_tty;
 
 void tty_get() {
@@ -23,4 +26,7 @@ void tty_restore() {
     tcsetattr(STDIN_FILENO, TCSANOW, &stdin_tty);
 }
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
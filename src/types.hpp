@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <cstdlib>
 
+namespace lasim {
+namespace internal {
+
 #define MEMORY_SIZE 0x10000L    // Total amount of WORDS in ENTIRE memory
 #define MEMORY_USER_MAX 0xFDFF  // Index of last WORD in user program area
 
@@ -76,12 +79,31 @@ enum class TrapVector {
     DEBUG = 0x2f,
 };
 
+// Kind of memory access by an instruction, for instrumentation
+enum class MemoryAccess {
+    FETCH,
+    READ,
+    WRITE,
+};
+
+// Limits for a single run of a program
+// 0 for no limit
+typedef struct Limits {
+    uint64_t max_instructions;
+    uint64_t max_output;  // Bytes
+    uint64_t max_milliseconds;
+} Limits;
+
 typedef struct ObjectFile {
     enum {
         FILE,
         MEMORY,
+        SNAPSHOT,  // Resumed, rather than started at file
     } kind;
     const char *filename;
 } ObjectFile;
 
+}  // namespace internal
+}  // namespace lasim
+
 #endif
@@ -0,0 +1,17 @@
+; Fixed branches for `bpred.sh`
+; Backward `BRp` is taken 3 of 4 times, forward `BRz` is taken once, and
+;     `BRnzp` is always taken
+.ORIG x3000
+    AND R1, R1, #0
+    ADD R1, R1, #4
+Loop
+    ADD R1, R1, #-1
+    BRp Loop
+    BRz Skip
+    ADD R0, R0, #1
+Skip
+    BRnzp End
+    ADD R0, R0, #1
+End
+    HALT
+.END
@@ -0,0 +1,22 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/bpred.asm"
+
+# Counters start weakly not taken, so bimodal mispredicts the first and last
+#     iterations of the loop, and gshare (with new history each iteration)
+#     also the second
+# `BRnzp` is counted, but never mispredicted
+expected_unconditional='            1  100.0%             0   0x3006    13  Skip'
+
+expect_predictor() {
+    report="$(lasim "$asm_file" --bpred "$1" 2>&1 >/dev/null)"
+    expect_lines "Branch predictor ($1): $2
+$expected_unconditional" "$report"
+}
+
+expect_predictor static '6 branches, 2 mispredicted (66.7% accuracy)' &&
+    expect_predictor bimodal '6 branches, 3 mispredicted (50.0% accuracy)' &&
+    expect_predictor gshare '6 branches, 4 mispredicted (33.3% accuracy)'
+report_status $?
@@ -0,0 +1,18 @@
+; Fixed data accesses for `cache.sh`
+; `A B A C A` hits more often with LRU than FIFO in a 2-line cache, and
+;     `D` is written twice then read, which only allocates with write-back
+.ORIG x3000
+    LD R0, A
+    LD R0, B
+    LD R0, A
+    LD R0, C
+    LD R0, A
+    ST R0, D
+    ST R0, D
+    LD R0, D
+    HALT
+A .FILL #1
+B .FILL #2
+C .FILL #3
+D .FILL #4
+.END
@@ -0,0 +1,30 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/cache.asm"
+
+# Fully associative with 2 one-word lines
+# Prints the line after the cache description, for each replacement and
+#     write policy
+cache_counts() {
+    lasim "$asm_file" --dcache "size=2,line=1,ways=2,$1" 2>&1 >/dev/null |
+        grep -E '^    [0-9]+ (accesses|writes)'
+}
+
+# LRU keeps `A` when `C` is filled, FIFO evicts it
+# Write-through does not allocate `D` on a write miss
+expected_lru_back='    8 accesses, 4 hits (50.0%), 4 misses'
+expected_fifo_back='    8 accesses, 3 hits (37.5%), 5 misses'
+expected_lru_through='    8 accesses, 2 hits (25.0%), 6 misses
+    2 writes to memory'
+expected_fifo_through='    8 accesses, 1 hits (12.5%), 7 misses
+    2 writes to memory'
+
+[ "$(cache_counts replace=lru,write=back)" = "$expected_lru_back" ] &&
+    [ "$(cache_counts replace=fifo,write=back)" = "$expected_fifo_back" ] &&
+    [ "$(cache_counts replace=lru,write=through)" = \
+        "$expected_lru_through" ] &&
+    [ "$(cache_counts replace=fifo,write=through)" = \
+        "$expected_fifo_through" ]
+report_status $?
@@ -0,0 +1,31 @@
+; Nested calls for `callgraph.sh`, then recursion beyond the maximum depth
+.ORIG x3000
+    LD R6, StackTop
+    JSR Outer
+    LD R1, Depth
+    JSR Rec
+    JSR Leaf
+    HALT
+; Calls `Leaf` through a register
+Outer
+    ADD R5, R7, #0
+    LEA R2, Leaf
+    JSRR R2
+    ADD R7, R5, #0
+    RET
+Leaf
+    ADD R0, R0, #1
+    RET
+Rec
+    ADD R6, R6, #-1
+    STR R7, R6, #0
+    ADD R1, R1, #-1
+    BRz RecEnd
+    JSR Rec
+RecEnd
+    LDR R7, R6, #0
+    ADD R6, R6, #1
+    RET
+StackTop .FILL x5000
+Depth .FILL #300
+.END
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/callgraph.asm"
+folded_file="$out/callgraph.folded"
+
+# `Leaf` is called through `JSRR` within `Outer`, then directly once the
+#     recursion returns, so its returns beyond the maximum depth do not pop
+# Recursion of 300 calls keeps 255 frames (below the root), with deeper
+#     calls counted in the deepest: 299 * 8 + 7 - 254 * 8
+deepest='x3000'
+for _ in $(seq 255); do
+    deepest="$deepest;Rec"
+done
+expected_lines="x3000 6
+x3000;Outer 5
+x3000;Outer;Leaf 2
+x3000;Leaf 2
+$deepest 367"
+
+lasim "$asm_file" --callgraph "$folded_file" >/dev/null 2>&1
+expect_lines "$expected_lines" "$(cat "$folded_file")" &&
+    [ "$(grep -c Rec "$folded_file")" -eq 255 ]
+report_status $?
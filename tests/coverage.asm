@@ -0,0 +1,18 @@
+; Prints whether input is `A`, to cover one branch per run
+.ORIG x3000
+    GETC
+    LD R1, Neg
+    ADD R1, R0, R1
+    BRz IsA
+    LEA R0, Other
+    PUTS
+    BR Done
+IsA
+    LEA R0, Yes
+    PUTS
+Done
+    HALT
+Neg .FILL x-41
+Yes .STRINGZ "A\n"
+Other .STRINGZ "other\n"
+.END
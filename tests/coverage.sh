@@ -0,0 +1,29 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/coverage.asm"
+bitmap_file="$out/coverage.lccov"
+lcov_file="$out/coverage.info"
+
+# Each run covers one branch, and the second is merged with the first
+expected_first='DA:11,0
+DA:12,0
+LF:10
+LH:8'
+expected_merged='DA:11,1
+DA:12,1
+LF:10
+LH:10'
+
+rm -f "$bitmap_file"
+status=0
+printf B | lasim "$asm_file" --coverage="$bitmap_file" --lcov "$lcov_file" \
+    >/dev/null 2>&1
+actual="$(grep -E '^(DA:1[12],|L[FH]:)' "$lcov_file")"
+[ "$actual" = "$expected_first" ] || status=1
+printf A | lasim "$asm_file" --coverage="$bitmap_file" --lcov "$lcov_file" \
+    >/dev/null 2>&1
+actual="$(grep -E '^(DA:1[12],|L[FH]:)' "$lcov_file")"
+[ "$actual" = "$expected_merged" ] || status=1
+report_status $status
@@ -0,0 +1,44 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+# Reuses counting program from trace test
+asm_file="$tests/trace.asm"
+script_file="$out/debugger.txt"
+
+cat > "$script_file" <<'SCRIPT'
+# Conditional, then hit-count breakpoint
+b Loop if R1 == 100 && mem[Value] == 100
+c
+r
+d, b Loop hit-count 3
+c
+mg x3008
+rstep
+r
+# Hit count is not limited to a word
+b Loop hit-count 18446744073709551616
+b Loop hit-count 18446744073709551615
+b
+SCRIPT
+expected='PC: 0x3000
+Set breakpoint at address 0x3002
+Breakpoint at address 0x3002. Suspending execution.
+PC: 0x3002
+pc=0x3002 cc=P r0=0x0000 r1=0x0064 r2=0x26ac r3=0x0000 r4=0x0000 r5=0x0000 r6=0x0000 r7=0x0000
+Removed all breakpoints
+Set breakpoint at address 0x3002
+Breakpoint at address 0x3002. Suspending execution.
+PC: 0x3002
+Value at address 0x3008:
+0x0067
+Reversed 1 instructions
+PC: 0x3005
+pc=0x3005 cc=P r0=0x0000 r1=0x0067 r2=0x26a9 r3=0x0000 r4=0x0000 r5=0x0000 r6=0x0000 r7=0x0000
+Count is too large
+Set breakpoint at address 0x3002
+    0x3002  Loop  hit-count 18446744073709551615  (0 hits)'
+
+actual="$(lasim "$asm_file" --debug-script "$script_file" 2>&1)"
+[ "$actual" = "$expected" ]
+report_status $?
@@ -0,0 +1,26 @@
+; Reads characters until newline or end of input, and crashes on `AB`
+.ORIG x3000
+Loop
+    GETC
+    ADD R1, R0, #0
+    BRn Done
+    LD R2, NegNewline
+    ADD R2, R0, R2
+    BRz Done
+    LD R2, NegA
+    ADD R2, R0, R2
+    BRnp Loop
+    GETC
+    LD R2, NegB
+    ADD R2, R0, R2
+    BRnp Loop
+    ; Address before program
+    LD R3, Bad
+    JMP R3
+Done
+    HALT
+NegNewline .FILL x-0A
+NegA .FILL x-41
+NegB .FILL x-42
+Bad .FILL x0000
+.END
@@ -0,0 +1,21 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/fuzz.asm"
+obj_file="$out/fuzz.obj"
+corpus_dir="$out/fuzz-corpus"
+
+lasim -a "$asm_file" -o "$obj_file" >/dev/null 2>&1
+# Exit code is 0x40 once a crash is found
+"$tests/../lasim" --fuzz "$obj_file" "$corpus_dir" --fuzz-runs 300000 \
+    >/dev/null 2>&1
+status=$?
+if [ $status -eq 64 ]; then
+    # Saved input crashes again
+    "$tests/../lasim" -x "$obj_file" --no-crash-dump \
+        <"$(ls "$corpus_dir"/crash-* | head -n 1)" >/dev/null 2>&1
+    [ $? -eq 64 ]
+    status=$?
+fi
+report_status $status
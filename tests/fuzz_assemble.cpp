@@ -0,0 +1,522 @@
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap
+#include <sys/stat.h>  // mkdir
+#include <sys/wait.h>  // waitpid
+#include <unistd.h>    // fork, dup2, usleep
+
+#include <cerrno>   // errno
+#include <csignal>  // kill, SIGKILL
+#include <cstdio>   // printf, fopen, fread, fwrite
+#include <cstdlib>  // strtoull, getenv
+#include <cstring>  // memcpy, strlen
+#include <vector>   // std::vector
+
+#include "../src/assemble.cpp"
+
+using namespace lasim::internal;
+using std::vector;
+
+// Persistent fuzz target for the tokenizer and assembler
+//
+// Each input is assembled in-process by `assemble_buffer`, so a run is a
+//     function call, rather than a process and a file.
+// `make fuzz-assemble` builds this with ASan, UBSan and `trace-pc` coverage.
+//     An input is kept in the corpus if it hits a new edge of the assembler,
+//     or an edge a new amount of times. Without coverage, every input is a
+//     mutation of a seed.
+// Fuzzing runs in a child process, so the parent sees a crash, or a hang
+//     (which it kills). The failing input is minimized by running each
+//     candidate in its own child, then saved as `crash-*` or `hang-*`, and
+//     fuzzing stops.
+// A run slower than `FUZZ_SLOW_NANOSECONDS` is minimized in the child, while
+//     it stays slow, and saved as `slow-*` if it is the slowest yet. It is not
+//     kept in the corpus.
+//
+// Usage: fuzz_assemble.bin RUNS OUT_DIR [SEED_FILE...]
+// Random seed is `FUZZ_SEED` from the environment, or else the time. It is
+//     printed with each status, so a run can be repeated.
+// Exit code is 1 if an input crashed or hanged
+
+#define FUZZ_MAX_INPUT 1024
+#define FUZZ_MAX_STACKED_MUTATIONS 8
+#define FUZZ_MAP_SIZE 65536
+#define FUZZ_SLOW_NANOSECONDS 50000000ULL
+#define FUZZ_HANG_NANOSECONDS 2000000000ULL
+#define FUZZ_STATUS_INTERVAL_NANOSECONDS 1000000000ULL
+// Candidates tried when minimizing, as each hanging one takes a while
+#define FUZZ_MAX_MINIMIZE_ATTEMPTS 512
+#define FUZZ_POLL_MICROSECONDS 1000
+
+// Parts of tokens which are unlikely to be made a byte at a time
+// Instruction and directive names are taken from the tokenizer
+static const char *const FUZZ_TOKENS[] = {
+    "R0", "R7", "R8", ", ", ":", ";", "\n", "\"", "\\", "\\n", "\\\"",
+    "x", "X", "#", "-", "#-", "x-", "0", "xFFFF", "x10000", "#32767",
+    "#-32768", "#65536", "#99999999999", "b1", "LABEL", "L0", "\t",
+};
+
+enum class Outcome {
+    OK,
+    CRASH,
+    HANG,
+};
+
+// Written by the fuzzing child, read by the parent once it has failed
+typedef struct FuzzShared {
+    uint64_t run_count;
+    // Nanoseconds, or 0 between runs
+    uint64_t run_start;
+    size_t length;
+    char input[FUZZ_MAX_INPUT];
+} FuzzShared;
+
+typedef struct FuzzTarget {
+    const char *out_dirname;
+    FuzzShared *shared;
+    vector<vector<char>> corpus;
+    Assembly assembly;
+
+    // Hit buckets seen for each edge, over all runs
+    uint8_t seen_buckets[FUZZ_MAP_SIZE];
+    size_t edge_count;
+
+    uint64_t slowest_nanoseconds;
+    uint64_t slow_count;
+    uint64_t random_seed;
+    uint64_t random_state;
+} FuzzTarget;
+
+// Edges of current run, only recorded while assembling
+static struct {
+    bool is_enabled;
+    uintptr_t previous_pc;
+    uint8_t hits[FUZZ_MAP_SIZE];
+    uint16_t hit_edges[FUZZ_MAP_SIZE];
+    size_t hit_edge_count;
+} trace;
+
+static FuzzTarget target;
+
+static void load_seeds(int argc, char **argv);
+static void fuzz_loop(const uint64_t max_runs);
+static uint64_t run_input(const vector<char> &input);
+static bool has_new_edges(void);
+static Outcome run_input_in_child(const vector<char> &input);
+static Outcome wait_for_child(const pid_t pid);
+static bool is_still_failing(const vector<char> &input, Outcome outcome);
+static void minimize_input(vector<char> &input, const Outcome outcome);
+static void save_input(const char *const prefix, const vector<char> &input);
+static void mutate_input(vector<char> &input);
+static void insert_token(
+    vector<char> &input, const size_t position, const char *const token
+);
+static uint64_t next_random(void);
+
+// Called before each basic block, with `-fsanitize-coverage=trace-pc`
+// Consecutive blocks are hashed, so each entry is (nearly) an edge
+extern "C" __attribute__((no_sanitize_coverage)) void
+__sanitizer_cov_trace_pc() {
+    if (!trace.is_enabled)
+        return;
+    const uintptr_t pc =
+        reinterpret_cast<uintptr_t>(__builtin_return_address(0));
+    const size_t index = (pc ^ trace.previous_pc) % FUZZ_MAP_SIZE;
+    trace.previous_pc = pc >> 1;
+    if (trace.hits[index] == 0)
+        trace.hit_edges[trace.hit_edge_count++] = index;
+    if (trace.hits[index] < 255)
+        ++trace.hits[index];
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s RUNS OUT_DIR [SEED_FILE...]\n", argv[0]);
+        return 2;
+    }
+    const uint64_t max_runs = strtoull(argv[1], nullptr, 10);
+    target.out_dirname = argv[2];
+    if (mkdir(target.out_dirname, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create directory: %s\n", argv[2]);
+        return 2;
+    }
+    load_seeds(argc - 3, argv + 3);
+    const char *const seed = getenv("FUZZ_SEED");
+    target.random_seed = seed != nullptr ? strtoull(seed, nullptr, 10)
+                                         : monotonic_nanoseconds();
+    // State of xorshift must not be 0
+    target.random_state = target.random_seed * 2 + 1;
+
+    void *const shared = mmap(
+        nullptr,
+        sizeof(FuzzShared),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "Could not map shared memory\n");
+        return 2;
+    }
+    target.shared = static_cast<FuzzShared *>(shared);
+
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        fuzz_loop(max_runs);
+        fflush(stdout);
+        _exit(0);
+    }
+    const Outcome outcome = wait_for_child(pid);
+    if (outcome == Outcome::OK)
+        return 0;
+
+    const FuzzShared &state = *target.shared;
+    vector<char> input(state.input, state.input + state.length);
+    printf(
+        "%s after %lu runs with seed %lu, minimizing %zu bytes\n",
+        outcome == Outcome::HANG ? "Hang" : "Crash",
+        static_cast<unsigned long>(state.run_count),
+        static_cast<unsigned long>(target.random_seed),
+        input.size()
+    );
+    fflush(stdout);
+    minimize_input(input, outcome);
+    save_input(outcome == Outcome::HANG ? "hang" : "crash", input);
+    return 1;
+}
+
+// Seeds are truncated to the maximum input size
+// No seeds are given one empty input
+static void load_seeds(int argc, char **argv) {
+    for (int i = 0; i < argc; ++i) {
+        FILE *const file = fopen(argv[i], "rb");
+        if (file == nullptr) {
+            fprintf(stderr, "Could not open seed file: %s\n", argv[i]);
+            continue;
+        }
+        char bytes[FUZZ_MAX_INPUT];
+        const size_t length = fread(bytes, 1, FUZZ_MAX_INPUT, file);
+        fclose(file);
+        target.corpus.push_back(vector<char>(bytes, bytes + length));
+    }
+    if (target.corpus.empty())
+        target.corpus.push_back({});
+}
+
+// Runs in the fuzzing child
+static void fuzz_loop(const uint64_t max_runs) {
+    FuzzShared &state = *target.shared;
+
+    // Seeds are run first, so their edges are not new later
+    const size_t seed_count = target.corpus.size();
+    for (size_t i = 0; i < seed_count && state.run_count < max_runs; ++i) {
+        run_input(target.corpus[i]);
+        has_new_edges();
+    }
+
+    const uint64_t start = monotonic_nanoseconds();
+    uint64_t next_status = start + FUZZ_STATUS_INTERVAL_NANOSECONDS;
+    vector<char> input;
+    while (state.run_count < max_runs) {
+        input = target.corpus[next_random() % target.corpus.size()];
+        mutate_input(input);
+        const uint64_t nanoseconds = run_input(input);
+        // Slow inputs are not kept, as their mutations would slow fuzzing
+        if (nanoseconds <= FUZZ_SLOW_NANOSECONDS) {
+            if (has_new_edges())
+                target.corpus.push_back(input);
+        } else if (nanoseconds > target.slowest_nanoseconds) {
+            target.slowest_nanoseconds = nanoseconds;
+            ++target.slow_count;
+            printf(
+                "Slow run of %lu ms, minimizing %zu bytes\n",
+                static_cast<unsigned long>(nanoseconds / 1000000),
+                input.size()
+            );
+            minimize_input(input, Outcome::OK);
+            save_input("slow", input);
+        }
+
+        const bool is_last = state.run_count >= max_runs;
+        if (state.run_count % 1024 != 0 && !is_last)
+            continue;
+        const uint64_t now = monotonic_nanoseconds();
+        if (now < next_status && !is_last)
+            continue;
+        const double seconds = (now - start) / 1e9;
+        printf(
+            "%-8s runs %lu (%.0f/s), corpus %zu, edges %zu, slow %lu, "
+            "seed %lu\n",
+            is_last ? "done" : "running",
+            static_cast<unsigned long>(state.run_count),
+            seconds > 0 ? state.run_count / seconds : 0.0,
+            target.corpus.size(),
+            target.edge_count,
+            static_cast<unsigned long>(target.slow_count),
+            static_cast<unsigned long>(target.random_seed)
+        );
+        fflush(stdout);
+        next_status = now + FUZZ_STATUS_INTERVAL_NANOSECONDS;
+    }
+}
+
+// Input is copied to shared memory first, so the parent has it on a failure
+// Input is also copied to a buffer of its exact size, so a read past its end
+//     is caught by ASan
+// Returns duration of run
+static uint64_t run_input(const vector<char> &input) {
+    FuzzShared &state = *target.shared;
+    state.length = input.size();
+    memcpy(state.input, input.data(), input.size());
+    char *const source = new char[input.size()];
+    memcpy(source, input.data(), input.size());
+
+    Assembly &assembly = target.assembly;
+    assembly.words.clear();
+    assembly.labels.clear();
+    assembly.line_numbers.clear();
+    assembly.is_instruction.clear();
+    assembly.diagnostics.clear();
+
+    for (size_t i = 0; i < trace.hit_edge_count; ++i)
+        trace.hits[trace.hit_edges[i]] = 0;
+    trace.hit_edge_count = 0;
+    trace.previous_pc = 0;
+
+    const uint64_t start = monotonic_nanoseconds();
+    __atomic_store_n(&state.run_start, start, __ATOMIC_RELAXED);
+    trace.is_enabled = true;
+    Error error = Error::OK;
+    assemble_buffer(source, input.size(), assembly, error);
+    trace.is_enabled = false;
+    const uint64_t end = monotonic_nanoseconds();
+    __atomic_store_n(&state.run_start, 0, __ATOMIC_RELAXED);
+
+    delete[] source;
+    ++state.run_count;
+    return end - start;
+}
+
+// Bucket of hit count is a single bit, so buckets seen are a mask
+static bool has_new_edges() {
+    bool has_new = false;
+    for (size_t i = 0; i < trace.hit_edge_count; ++i) {
+        const uint16_t index = trace.hit_edges[i];
+        const uint8_t hits = trace.hits[index];
+        uint8_t bucket;
+        if (hits <= 3)
+            bucket = 1 << (hits - 1);  // 1, 2, 3
+        else if (hits < 8)
+            bucket = 1 << 3;
+        else if (hits < 16)
+            bucket = 1 << 4;
+        else if (hits < 32)
+            bucket = 1 << 5;
+        else if (hits < 128)
+            bucket = 1 << 6;
+        else
+            bucket = 1 << 7;
+
+        uint8_t &seen = target.seen_buckets[index];
+        if (bucket & ~seen) {
+            if (seen == 0)
+                ++target.edge_count;
+            seen |= bucket;
+            has_new = true;
+        }
+    }
+    return has_new;
+}
+
+// Sanitizer reports are discarded, as minimizing repeats them many times
+static Outcome run_input_in_child(const vector<char> &input) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0)
+            dup2(null_fd, STDERR_FILENO);
+        run_input(input);
+        _exit(0);
+    }
+    return wait_for_child(pid);
+}
+
+// Any exit other than success is a crash, as sanitizers exit with 1
+// Child is killed if a run takes too long
+static Outcome wait_for_child(const pid_t pid) {
+    if (pid < 0) {
+        fprintf(stderr, "Could not fork\n");
+        return Outcome::CRASH;
+    }
+    while (true) {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+                return Outcome::OK;
+            return Outcome::CRASH;
+        }
+        const uint64_t start =
+            __atomic_load_n(&target.shared->run_start, __ATOMIC_RELAXED);
+        if (start != 0 &&
+            monotonic_nanoseconds() - start > FUZZ_HANG_NANOSECONDS) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            target.shared->run_start = 0;
+            return Outcome::HANG;
+        }
+        usleep(FUZZ_POLL_MICROSECONDS);
+    }
+}
+
+// A slow input (`Outcome::OK`) is run in this process, and must stay slow
+static bool is_still_failing(const vector<char> &input, Outcome outcome) {
+    if (outcome == Outcome::OK)
+        return run_input(input) > FUZZ_SLOW_NANOSECONDS;
+    return run_input_in_child(input) == outcome;
+}
+
+// Removes chunks, halving their size, while the input still fails
+static void minimize_input(vector<char> &input, const Outcome outcome) {
+    size_t attempts = 0;
+    vector<char> candidate;
+    for (size_t chunk = (input.size() + 1) / 2; chunk > 0; chunk /= 2) {
+        size_t start = 0;
+        while (start < input.size()) {
+            if (++attempts > FUZZ_MAX_MINIMIZE_ATTEMPTS)
+                return;
+            const size_t end =
+                start + chunk < input.size() ? start + chunk : input.size();
+            candidate.assign(input.begin(), input.begin() + start);
+            candidate.insert(candidate.end(), input.begin() + end, input.end());
+            if (is_still_failing(candidate, outcome))
+                input.swap(candidate);
+            else
+                start = end;
+        }
+    }
+}
+
+// Named by FNV-1a hash of input, so equal inputs have the same file
+static void save_input(const char *const prefix, const vector<char> &input) {
+    uint32_t hash = 2166136261;
+    for (size_t i = 0; i < input.size(); ++i)
+        hash = (hash ^ static_cast<uint8_t>(input[i])) * 16777619;
+
+    char path[FILENAME_MAX * 2];
+    snprintf(
+        path,
+        sizeof(path),
+        "%s/%s-%08x",
+        target.out_dirname,
+        prefix,
+        static_cast<unsigned>(hash)
+    );
+    FILE *const file = fopen(path, "wb");
+    bool is_written =
+        file != nullptr &&
+        fwrite(input.data(), 1, input.size(), file) == input.size();
+    if (file != nullptr && fclose(file) != 0)
+        is_written = false;
+    if (is_written)
+        printf("    Saved input (%zu bytes): %s\n", input.size(), path);
+    else
+        fprintf(stderr, "Failed to write input file: %s\n", path);
+    fflush(stdout);
+}
+
+// Applies several random mutations, of bytes or of whole tokens
+static void mutate_input(vector<char> &input) {
+    const size_t count = 1 + next_random() % FUZZ_MAX_STACKED_MUTATIONS;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t random = next_random();
+        size_t kind = random % 8;
+        const char byte = static_cast<char>(random >> 8);
+        const size_t position = (random >> 32) % (input.size() + 1);
+        const size_t choice = random >> 16 & 0xffff;
+
+        // Others need a byte to change
+        if (input.empty() && kind < 4)
+            kind = 4 + kind % 4;
+        if (kind >= 4 && kind <= 6 && input.size() >= FUZZ_MAX_INPUT)
+            kind = 3;
+
+        switch (kind) {
+            case 0:
+                input[position % input.size()] ^= 1 << (byte & 7);
+                break;
+            case 1:
+                input[position % input.size()] = byte;
+                break;
+            case 2:
+                // Small change, such as to a neighbouring digit
+                input[position % input.size()] += (byte & 7) - 3;
+                break;
+            case 3: {
+                const size_t start = position % input.size();
+                size_t length = 1 + static_cast<uint8_t>(byte) % 16;
+                if (length > input.size() - start)
+                    length = input.size() - start;
+                input.erase(
+                    input.begin() + start, input.begin() + start + length
+                );
+            }; break;
+            case 4:
+                insert_token(
+                    input,
+                    position,
+                    INSTRUCTION_NAMES
+                        [choice % (sizeof(INSTRUCTION_NAMES) / sizeof(char *))]
+                );
+                break;
+            case 5: {
+                char directive[16];
+                snprintf(
+                    directive,
+                    sizeof(directive),
+                    ".%s",
+                    DIRECTIVE_NAMES
+                        [choice % (sizeof(DIRECTIVE_NAMES) / sizeof(char *))]
+                );
+                insert_token(input, position, directive);
+            }; break;
+            case 6:
+                insert_token(
+                    input,
+                    position,
+                    FUZZ_TOKENS[choice % (sizeof(FUZZ_TOKENS) / sizeof(char *))]
+                );
+                break;
+            case 7: {
+                // Start of this input, then rest of another
+                const vector<char> &other =
+                    target.corpus[(random >> 48) % target.corpus.size()];
+                input.resize(position);
+                if (position < other.size()) {
+                    input.insert(
+                        input.end(), other.begin() + position, other.end()
+                    );
+                }
+            }; break;
+        }
+    }
+}
+
+// Token is cut short at the maximum input size
+static void insert_token(
+    vector<char> &input, const size_t position, const char *const token
+) {
+    size_t length = strlen(token);
+    if (length > FUZZ_MAX_INPUT - input.size())
+        length = FUZZ_MAX_INPUT - input.size();
+    input.insert(input.begin() + position, token, token + length);
+}
+
+// xorshift64*
+static uint64_t next_random() {
+    uint64_t &state = target.random_state;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
@@ -0,0 +1,9 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+# Without sanitizers or coverage, so only a short run of mutated examples
+# Fixed seed, so a failure can be repeated
+FUZZ_SEED=1 "$out/fuzz_assemble.bin" 20000 "$out/fuzz-assemble" \
+    "$examples"/*.asm "$tests"/*.asm >/dev/null
+report_status $?
@@ -0,0 +1,18 @@
+; Fixed data accesses for `heatmap.sh`
+; Loop of 4 instructions reads `Value` and writes `Copy`, 512 times, then
+;     `Message` is read by `PUTS`
+.ORIG x3000
+    LD R1, Count
+Loop
+    LD R0, Value
+    ST R0, Copy
+    ADD R1, R1, #-1
+    BRp Loop
+    LEA R0, Message
+    PUTS
+    HALT
+Count .FILL #512
+Value .FILL #7
+Copy .FILL #0
+Message .STRINGZ "ok"
+.END
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/heatmap.asm"
+csv_file="$out/heatmap.csv"
+
+expected_csv='address,reads,writes
+0x3008,1,0
+0x3009,512,0
+0x300a,0,512
+0x300b,1,0
+0x300c,1,0
+0x300d,1,0'
+# 2052 instructions: the first window reads `Count`, the last is only the
+#     end of the loop and `PUTS` (which reads the string and its terminator)
+expected_lines='Memory accesses: 516 reads, 512 writes, 6 distinct addresses
+                 0            3
+              1024            2
+              2048            3'
+
+report="$(lasim "$asm_file" --heatmap "$csv_file" 2>&1 >/dev/null)"
+[ "$(cat "$csv_file")" = "$expected_csv" ] &&
+    expect_lines "$expected_lines" "$report"
+report_status $?
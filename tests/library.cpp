@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <cstring>
+
+#include "../src/lasim.hpp"
+
+#define assert_eq(_msg, _left, _right)        \
+    {                                         \
+        auto left = (_left);                  \
+        auto right = (_right);                \
+        if (left != right) {                  \
+            printf("Failed: %s\n", (_msg));   \
+            printf("\t left: %s\n", #_left);  \
+            printf("\tright: %s\n", #_right); \
+            return 1;                         \
+        }                                     \
+    }
+
+typedef struct Output {
+    char buffer[64];
+    size_t length;
+} Output;
+
+void write_output(char ch, void *context) {
+    Output *const output = static_cast<Output *>(context);
+    if (output->length < sizeof(output->buffer) - 1)
+        output->buffer[output->length++] = ch;
+    output->buffer[output->length] = '\0';
+}
+
+int read_input(void *context) {
+    (void)context;
+    return 'z';
+}
+
+int main() {
+    const char source[] =
+        ".ORIG x3000\n"
+        "    GETC\n"
+        "    OUT\n"
+        "    AND R1, R1, #0\n"
+        "    ADD R1, R1, #3\n"
+        "Loop ADD R1, R1, #-1\n"
+        "    BRp Loop\n"
+        "    LEA R0, Message\n"
+        "    PUTS\n"
+        "    HALT\n"
+        "Message .STRINGZ \"ok\"\n"
+        ".END\n";
+
+    lasim::Machine *machine = lasim::create_machine();
+    Output output = {};
+    lasim::set_io(machine, read_input, write_output, &output);
+
+    assert_eq("Load source",
+              lasim::load_source(machine, source, sizeof(source) - 1), true);
+    assert_eq("Initial PC", lasim::read_pc(machine), 0x3000);
+
+    assert_eq("Step", lasim::step(machine), lasim::Status::RUNNING);
+    assert_eq("Input", lasim::read_register(machine, 0), 'z');
+
+    assert_eq("Run budget", lasim::run(machine, 3), lasim::Status::RUNNING);
+    assert_eq("Instruction count", lasim::instruction_count(machine), 4ul);
+    assert_eq("Register", lasim::read_register(machine, 1), 3);
+
+    assert_eq("Run", lasim::run(machine, 1000), lasim::Status::HALTED);
+    assert_eq("Register", lasim::read_register(machine, 1), 0);
+    assert_eq("Condition", lasim::read_condition(machine), 'P');
+    assert_eq("Output", strcmp(output.buffer, "zok"), 0);
+
+    lasim::write_memory(machine, 0x4000, 0xbeef);
+    assert_eq("Memory", lasim::read_memory(machine, 0x4000), 0xbeef);
+
+    const char bad_source[] = ".ORIG x3000\nFOO BAR\n.END\n";
+    assert_eq("Load bad source",
+              lasim::load_source(machine, bad_source, sizeof(bad_source) - 1),
+              false);
+    assert_eq("Diagnostic count", lasim::diagnostic_count(machine), 1ul);
+    assert_eq("Diagnostic line", lasim::diagnostic_line(machine, 0), 2);
+    assert_eq("Step after failed load", lasim::step(machine),
+              lasim::Status::FAILED);
+
+    const uint8_t object[] = {0x30, 0x00, 0xf0, 0x25};
+    assert_eq("Load object",
+              lasim::load_object(machine, object, sizeof(object)), true);
+    assert_eq("Run object", lasim::run(machine, 10), lasim::Status::HALTED);
+
+    const uint8_t odd_object[] = {0x30, 0x00, 0xf0};
+    assert_eq("Load odd object",
+              lasim::load_object(machine, odd_object, sizeof(odd_object)),
+              false);
+    assert_eq("Odd object diagnostic", lasim::diagnostic_count(machine), 1ul);
+    assert_eq("Odd object diagnostic line", lasim::diagnostic_line(machine, 0),
+              0);
+
+    // Opcode 0xD is reserved
+    const uint8_t bad_object[] = {0x30, 0x00, 0xd0, 0x00};
+    assert_eq("Load bad object",
+              lasim::load_object(machine, bad_object, sizeof(bad_object)),
+              true);
+    assert_eq("Step bad opcode", lasim::step(machine), lasim::Status::FAILED);
+    assert_eq("Bad opcode diagnostic", lasim::diagnostic_count(machine), 1ul);
+
+    lasim::destroy_machine(machine);
+}
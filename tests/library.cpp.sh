@@ -0,0 +1,6 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+"$out/library.bin"
+report_status $?
@@ -0,0 +1,11 @@
+; Never halts, printing forever
+.ORIG x3000
+
+Loop
+    LEA R0, Message
+    PUTS
+    BR Loop
+
+Message .STRINGZ "limit"
+
+.END
@@ -0,0 +1,19 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/limits.asm"
+
+# Expect exit code for each limit, without `lasim` wrapper (which exits)
+expect_limit() {
+    expected="$1"
+    shift
+    "$project/lasim" "$asm_file" "$@" >/dev/null 2>&1
+    [ $? -eq "$expected" ]
+}
+
+expect_limit 65 --max-instructions 10000 &&
+    expect_limit 66 --max-output 100 &&
+    expect_limit 67 --max-time 50 &&
+    expect_limit 68 --detect-loops
+report_status $?
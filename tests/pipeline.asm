@@ -0,0 +1,22 @@
+; Fixed stalls for `pipeline.sh`, with default costs
+.ORIG x3000
+    LD R1, Value        ; Memory 0
+    ADD R2, R1, #0      ; Load-use 1
+    LD R1, Value
+    ADD R2, R3, #0      ; Independent
+    LD R1, Value
+    BRz Never           ; Load-use 1, as the load set the condition
+    LEA R1, Value
+    BRz Never           ; Condition set by `LEA` is forwarded
+    ADD R1, R1, #0
+    BRnp Skip           ; Taken, branch 2
+    ADD R0, R0, #0
+Skip
+    LDI R1, Pointer     ; Memory 1, for second access
+    ST R1, Value        ; Load-use 1
+    HALT                ; Branch 2
+Never
+    HALT
+Value .FILL #7
+Pointer .FILL x300f   ; `Value`
+.END
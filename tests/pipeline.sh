@@ -0,0 +1,26 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/pipeline.asm"
+
+# Stalls of each instruction are commented in the program
+# Memory stall is `accesses * memory - 1`, so at 3 cycles per access, each
+#     of 3 `LD`s and the `ST` stalls for 2, and `LDI` for 5
+expected_default='Pipeline (load-use 1, branch 2, memory 1 cycles): 25 cycles, 13 instructions (1.92 CPI)
+    Stalls: 3 load-use, 4 branch, 1 memory, 4 fill
+              0            2            0   0x3009    12
+              0            2            0   0x300d    17  Skip+2
+              1            0            0   0x3001     4
+              1            0            0   0x3005     8
+              0            0            1   0x300b    15  Skip
+              1            0            0   0x300c    16  Skip+1'
+expected_slow_memory='    Stalls: 3 load-use, 4 branch, 13 memory, 4 fill'
+
+report_default="$(lasim "$asm_file" --pipeline 2>&1 >/dev/null)"
+report_slow_memory="$(lasim "$asm_file" --pipeline=memory=3 2>&1 >/dev/null)"
+# Only those instructions stall
+[ "$(echo "$report_default" | grep -c '   0x')" -eq 6 ] &&
+    expect_lines "$expected_default" "$report_default" &&
+    expect_lines "$expected_slow_memory" "$report_slow_memory"
+report_status $?
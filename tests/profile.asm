@@ -0,0 +1,12 @@
+; Fixed counts for `profile.sh`
+.ORIG x3000
+    AND R1, R1, #0
+    ADD R1, R1, #3
+Loop
+    LEA R0, Message
+    PUTS
+    ADD R1, R1, #-1
+    BRp Loop
+    HALT
+Message .STRINGZ "x"
+.END
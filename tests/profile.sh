@@ -0,0 +1,20 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/profile.asm"
+
+# Loop of 4 instructions runs 3 times, between 2 instructions and `HALT`
+expected_lines='Profile: 15 instructions
+          3   20.0%   0x3002     6  Loop
+          1    6.7%   0x3006    10  Loop+4
+    ADD                4   26.7%
+    TRAP               4   26.7%
+    PUTS               3
+    HALT               1
+          3     7 |     PUTS
+          0    11 | Message .STRINGZ "x"'
+
+report="$(lasim "$asm_file" --profile 2>&1 >/dev/null)"
+expect_lines "$expected_lines" "$report"
+report_status $?
@@ -0,0 +1,122 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define assert_eq(_msg, _left, _right)        \
+    {                                         \
+        auto left = (_left);                  \
+        auto right = (_right);                \
+        if (left != right) {                  \
+            printf("Failed: %s\n", (_msg));   \
+            printf("\t left: %s\n", #_left);  \
+            printf("\tright: %s\n", #_right); \
+            return 1;                         \
+        }                                     \
+    }
+
+using std::vector;
+
+// Client for `lasim --serve`, sending one job, see `src/server.cpp`
+// Usage: server.bin SOCKET
+
+void push_u32(vector<char> &buffer, const uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        buffer.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+void push_u64(vector<char> &buffer, const uint64_t value) {
+    for (int i = 0; i < 8; ++i)
+        buffer.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+bool read_exact(const int fd, void *const buffer, const size_t length) {
+    char *const bytes = static_cast<char *>(buffer);
+    size_t total = 0;
+    while (total < length) {
+        const ssize_t count = read(fd, bytes + total, length - total);
+        if (count <= 0)
+            return false;
+        total += count;
+    }
+    return true;
+}
+
+uint64_t take_integer(const uint8_t *&bytes, const int size) {
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; --i)
+        value = value << 8 | bytes[i];
+    bytes += size;
+    return value;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s SOCKET\n", argv[0]);
+        return 2;
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert_eq(
+        "Connect",
+        connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)),
+        0
+    );
+
+    const char source[] =
+        ".ORIG x3000\n"
+        "    GETC\n"
+        "    OUT\n"
+        "    GETC\n"
+        "    OUT\n"
+        "    HALT\n"
+        ".END\n";
+    const char input[] = "ok";
+
+    vector<char> request;
+    request.push_back(0);  // Source
+    push_u32(request, sizeof(source) - 1);
+    request.insert(request.end(), source, source + sizeof(source) - 1);
+    push_u32(request, sizeof(input) - 1);
+    request.insert(request.end(), input, input + sizeof(input) - 1);
+    push_u64(request, 0);  // Server default limits
+    push_u32(request, 0);
+    push_u32(request, 0);
+    assert_eq(
+        "Send request",
+        write(fd, request.data(), request.size()),
+        static_cast<ssize_t>(request.size())
+    );
+
+    // Status, halted, instruction count, elapsed, output length
+    uint8_t header[4 + 1 + 8 + 8 + 4];
+    assert_eq("Read response", read_exact(fd, header, sizeof(header)), true);
+    const uint8_t *bytes = header;
+    assert_eq("Status", take_integer(bytes, 4), 0ul);
+    assert_eq("Halted", take_integer(bytes, 1), 1ul);
+    assert_eq("Instruction count", take_integer(bytes, 8), 5ul);
+    take_integer(bytes, 8);
+    const uint64_t output_length = take_integer(bytes, 4);
+
+    // Newline is added after `HALT`, as by `lasim`
+    char output[16] = {0};
+    assert_eq("Output length", output_length, 3ul);
+    assert_eq("Read output", read_exact(fd, output, output_length), true);
+    assert_eq("Output", strcmp(output, "ok\n"), 0);
+
+    uint8_t length_bytes[4];
+    assert_eq("Read diagnostics", read_exact(fd, length_bytes, 4), true);
+    bytes = length_bytes;
+    assert_eq("Diagnostics length", take_integer(bytes, 4), 0ul);
+
+    close(fd);
+    return 0;
+}
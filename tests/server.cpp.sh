@@ -0,0 +1,21 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+socket="$out/server.sock"
+rm -f "$socket"
+"$tests/../lasim" --serve "$socket" &
+server=$!
+
+# Wait for socket to be bound
+for i in $(seq 50); do
+    [ -S "$socket" ] && break
+    sleep 0.1
+done
+
+"$out/server.bin" "$socket"
+status=$?
+kill $server
+wait $server 2>/dev/null
+rm -f "$socket"
+report_status $status
@@ -25,6 +25,13 @@ diff() {
     /usr/bin/delta $@
 }
 
+# Each line of `$1` must be a whole line of `$2`, in any order
+expect_lines() {
+    echo "$1" | while IFS= read -r line; do
+        echo "$2" | grep -qxF -- "$line" || exit 1
+    done
+}
+
 report_status() {
     if [ "$1" -eq 0 ];
         then printf '\x1b[32mpass\x1b[0m\n'
@@ -0,0 +1,20 @@
+; Stopped at `DEBUG` by `snapshot.sh`, then resumed
+; Characters read before the trap are stored, so they must be restored, and
+;     stdin must be skipped past them
+.ORIG x3000
+    GETC
+    ST R0, First
+    GETC
+    ADD R1, R0, #0
+    DEBUG
+    GETC
+    ADD R2, R0, #0
+    LD R0, First
+    OUT
+    ADD R0, R1, #0
+    OUT
+    ADD R0, R2, #0
+    OUT
+    HALT
+First .FILL #0
+.END
@@ -0,0 +1,21 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/snapshot.asm"
+snapshot_file="$out/snapshot.lcs"
+
+# Output depends on memory and registers from before the trap, and on the
+#     input read before it being skipped (otherwise the last is `a`)
+expected='abc'
+
+rm -f "$snapshot_file"
+# Each run must also succeed
+uninterrupted="$(printf abc | lasim "$asm_file" 2>/dev/null)" &&
+    stopped="$(printf abc |
+        lasim "$asm_file" --save-snapshot "$snapshot_file" 2>/dev/null)" &&
+    resumed="$(printf abc | lasim --snapshot "$snapshot_file" 2>/dev/null)" &&
+    [ "$uninterrupted" = "$expected" ] &&
+    [ -z "$stopped" ] &&
+    [ "$resumed" = "$uninterrupted" ]
+report_status $?
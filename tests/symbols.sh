@@ -0,0 +1,30 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/profile.asm"
+obj_file="$out/symbols.obj"
+symbols_file="$out/symbols.sym"
+truncated_file="$out/symbols-truncated.sym"
+script_file="$out/symbols.dbg"
+
+# Object is run without its source, so labels and lines are from the file
+printf 'b Loop\nc\n' >"$script_file"
+expected_lines='Set breakpoint at address 0x3002
+          3   20.0%   0x3002     6  Loop
+          1    6.7%   0x3006    10  Loop+4'
+
+lasim -a "$asm_file" -o "$obj_file" --symbols "$symbols_file" >/dev/null
+report="$(lasim -x "$obj_file" --symbols "$symbols_file" \
+    --debug-script "$script_file" --profile 2>&1 >/dev/null)"
+expect_lines "$expected_lines" "$report"
+status=$?
+
+# Every truncation is rejected, rather than read as fewer labels or lines
+size=$(wc -c <"$symbols_file")
+for length in $(seq 0 $((size - 1))); do
+    head -c $length "$symbols_file" >"$truncated_file"
+    "$project/lasim" -x "$obj_file" --symbols "$truncated_file" 2>&1 |
+        grep -q '^Invalid symbols file' || status=1
+done
+report_status $status
@@ -3,6 +3,8 @@
 #include "../src/assemble.cpp"
 #include "../src/execute.cpp"
 
+using namespace lasim::internal;
+
 #define assert_eq(_msg, _left, _right)           \
     {                                            \
         auto left = (_left);                     \
@@ -47,4 +49,32 @@ int main() {
               does_positive_integer_fit_size(-0x7fff, 5), false);
     assert_eq("Negative number doesn't fit in size",
               does_positive_integer_fit_size(-0x8000, 5), false);
+
+    // Assemble from buffer, without reading a file
+    const char source[] =
+        ".ORIG x3000\n"
+        "Loop ADD R1, R1, #-1\n"
+        "    BRp Loop\n"
+        "    HALT\n"
+        ".END";
+    Assembly assembly;
+    Error error = Error::OK;
+    assemble_buffer(source, sizeof(source) - 1, assembly, error);
+    assert_eq("Assemble buffer", static_cast<int>(error), 0x00);
+    assert_eq("Assemble buffer size",
+              static_cast<int>(assembly.words.size()), 4);
+    assert_eq("Assemble buffer origin", assembly.words[0], 0x3000);
+    assert_eq("Assemble buffer branch", assembly.words[2], 0x03fe);
+    assert_eq("Assemble buffer label", assembly.labels[0].index, 1);
+    assert_eq("Assemble buffer line", assembly.line_numbers[2], 3);
+
+    const char bad_source[] = ".ORIG x3000\nADD R1, R1, #100\n.END\n";
+    Assembly bad_assembly;
+    error = Error::OK;
+    assemble_buffer(bad_source, sizeof(bad_source) - 1, bad_assembly, error);
+    assert_eq("Assemble buffer error", static_cast<int>(error), 0x30);
+    assert_eq("Diagnostic count",
+              static_cast<int>(bad_assembly.diagnostics.size()), 1);
+    assert_eq("Diagnostic line",
+              bad_assembly.diagnostics[0].line_number, 2);
 }
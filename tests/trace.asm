@@ -0,0 +1,12 @@
+; Counts to 10000, storing each count
+.ORIG x3000
+        AND R1, R1, #0
+        LD R2, Count
+Loop    ADD R1, R1, #1
+        ST R1, Value
+        ADD R2, R2, #-1
+        BRp Loop
+        HALT
+Count   .FILL #10000
+Value   .FILL #0
+.END
@@ -0,0 +1,25 @@
+#!/bin/sh
+
+source "$(dirname $0)/shared.sh"
+
+asm_file="$tests/trace.asm"
+trace_file="$out/trace.lctrace"
+
+# Checkpoint (every 4096 instructions) is before the last step
+queries='write Value before 30001
+reg R1 at 20000
+reach Loop
+state 40003'
+expected='step 30000 value x1d4c
+step 19999 value x1388
+first 3 last 39999 count 10000
+step 40003 pc x3006 cc Z r0 x0000 r1 x2710 r2 x0000 r3 x0000 r4 x0000 r5 x0000 r6 x0000 r7 x0000'
+
+lasim "$asm_file" --trace "$trace_file" >/dev/null 2>&1
+# Second run uses index from first
+status=0
+for _ in 1 2; do
+    actual="$(echo "$queries" | lasim --trace-query "$trace_file" "$asm_file")"
+    [ "$actual" = "$expected" ] || status=1
+done 2>/dev/null
+report_status $status